@@ -846,6 +846,227 @@ int main() {
   return 0;
 }
 
+// Challenge - Frank's Carpet Cleaning Service, quoting a whole file of jobs
+// Frank's business is growing and the call center sends over a file with thousands of jobs at a time, one job per line: number of small rooms and number of large rooms. Asking for them one by one with cin and printing each line with endl (which flushes the stream every time) is far too slow for that. This engine reads the whole file in large blocks, prices every job in one pass and writes the quotes into a large buffer that goes out in big writes, either as text (one tab-separated line per quote) or as binary Quote records that another program can read back directly. Money is kept in whole cents (long long) instead of double, so 6% tax on $110 is exactly 660 cents and the totals add up to the cent no matter how many quotes there are. The prices, the tax rate and the expiry are options instead of constants. --benchmark compares the engine with the interactive code (cout << ... << endl per line) on the same jobs.
+// usage: carpet_quotes <jobs file> [--small 25] [--large 35] [--tax 0.06] [--expiry 30] [--binary]
+//        carpet_quotes --benchmark <number of jobs>
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <charconv>
+#include <chrono>
+#include <stdexcept>
+using namespace std;
+
+struct Rates {
+  int64_t price_per_small_room {2500};  // cents
+  int64_t price_per_large_room {3500};  // cents
+  int64_t sales_tax {600};              // basis points: 600 = 6.00%
+  int estimate_expiry {30};             // days
+};
+
+struct Job {
+  uint32_t number_of_small_rooms;
+  uint32_t number_of_large_rooms;
+};
+
+struct Quote {                          // the binary output record
+  uint32_t number_of_small_rooms;
+  uint32_t number_of_large_rooms;
+  int64_t cost;                         // cents
+  int64_t tax;                          // cents
+  int64_t total;                        // cents
+};
+
+// tax is rounded to the nearest cent, halves up
+inline Quote make_quote(const Job &job, const Rates &rates) {
+  int64_t cost = rates.price_per_small_room * job.number_of_small_rooms + rates.price_per_large_room * job.number_of_large_rooms;
+  int64_t tax = (cost * rates.sales_tax + 5000) / 10000;
+  return {job.number_of_small_rooms, job.number_of_large_rooms, cost, tax, cost + tax};
+}
+
+// two numbers per job, anything that isn't a digit separates them - unpaired is true when the last number had no partner and was left out
+vector<Job> read_jobs(FILE *in, bool &unpaired) {
+  vector<Job> jobs;
+  vector<char> block(1 << 20);
+  uint32_t value {0}, fields[2];
+  int field {0};
+  bool in_number {false};
+  auto end_number = [&]() {
+    fields[field++] = value;
+    if (field == 2) {
+      jobs.push_back({fields[0], fields[1]});
+      field = 0;
+    }
+    value = 0;
+    in_number = false;
+  };
+  while (size_t used = fread(block.data(), 1, block.size(), in))
+    for (size_t i {0}; i < used; ++i) {
+      char c = block[i];
+      if (c >= '0' && c <= '9') {
+        value = value * 10 + (c - '0');
+        in_number = true;
+      } else if (in_number) {
+        end_number();
+      }
+    }
+  if (in_number)
+    end_number();
+  unpaired = field != 0;
+  return jobs;
+}
+
+// writes cents as dollars with two decimals: 11660 -> 116.60
+inline char *write_dollars(char *p, char *end, int64_t cents) {
+  p = to_chars(p, end, cents / 100).ptr;
+  *p++ = '.';
+  *p++ = static_cast<char>('0' + cents % 100 / 10);
+  *p++ = static_cast<char>('0' + cents % 10);
+  return p;
+}
+
+class QuoteWriter {
+  vector<char> buffer;
+  size_t used {0};
+  FILE *out;
+  bool binary;
+public:
+  QuoteWriter(FILE *out, bool binary) : buffer(1 << 20), out{out}, binary{binary} {}
+  ~QuoteWriter() { flush(); }
+  void flush() {
+    fwrite(buffer.data(), 1, used, out);
+    used = 0;
+  }
+  void write(const Quote &quote) {
+    if (buffer.size() - used < 128)
+      flush();
+    char *p = buffer.data() + used;
+    char *end = buffer.data() + buffer.size();
+    if (binary) {
+      const char *bytes = reinterpret_cast<const char *>(&quote);
+      p = copy(bytes, bytes + sizeof(Quote), p);
+    } else {
+      p = to_chars(p, end, quote.number_of_small_rooms).ptr;
+      *p++ = '\t';
+      p = to_chars(p, end, quote.number_of_large_rooms).ptr;
+      *p++ = '\t';
+      p = write_dollars(p, end, quote.cost);
+      *p++ = '\t';
+      p = write_dollars(p, end, quote.tax);
+      *p++ = '\t';
+      p = write_dollars(p, end, quote.total);
+      *p++ = '\n';
+    }
+    used = p - buffer.data();
+  }
+};
+
+// the interactive program's output for one job, kept as it was - only used by the benchmark
+void interactive_estimate(ostream &out, const Job &job) {
+  const double  price_per_small_room {25};
+  const double  price_per_large_room {35};
+  const double sales_tax {0.06};
+  const int estimate_expiry {30};
+  out << "\nEstimate for carpet cleaning service" << endl;
+  out << "Number of small rooms: " << job.number_of_small_rooms << endl;
+  out << "Number of large rooms: " << job.number_of_large_rooms << endl;
+  out << "Price per small room: $" << price_per_small_room << endl;
+  out << "Price per large room: $" << price_per_large_room << endl;
+  int cost = (price_per_small_room * job.number_of_small_rooms) + (price_per_large_room * job.number_of_large_rooms);
+  double tax = cost * sales_tax;
+  out << "Cost : $" << cost << endl;
+  out << "Tax: $" << tax << endl;
+  out << "===============================" << endl;
+  out << "Total estimate: $" << cost + tax << endl;
+  out << "This estimate is valid for " << estimate_expiry << " days" << endl;
+}
+
+void benchmark(size_t count) {
+  vector<Job> jobs(count);
+  for (size_t i {0}; i < count; ++i)
+    jobs[i] = {static_cast<uint32_t>(i % 7), static_cast<uint32_t>(i % 5)};
+  Rates rates;
+
+  ofstream null_stream {"/dev/null"};
+  auto start = chrono::steady_clock::now();
+  for (const auto &job: jobs)
+    interactive_estimate(null_stream, job);
+  double interactive = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  FILE *null_file = fopen("/dev/null", "wb");
+  start = chrono::steady_clock::now();
+  {
+    QuoteWriter writer {null_file, false};
+    for (const auto &job: jobs)
+      writer.write(make_quote(job, rates));
+  }
+  double engine = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  fclose(null_file);
+
+  cout << "interactive path : " << count / interactive / 1e6 << " million quotes/s" << endl;
+  cout << "quote engine     : " << count / engine / 1e6 << " million quotes/s" << endl;
+}
+
+int main(int argc, char *argv[]) {
+  const string usage {string {"usage: "} + argv[0] + " <jobs file> [--small 25] [--large 35] [--tax 0.06] [--expiry 30] [--binary]"};
+  Rates rates;
+  bool binary {false};
+  try {                                 // stod and friends throw on "abc" or a number out of range
+    if (argc == 3 && string {argv[1]} == "--benchmark") {
+      benchmark(stoull(argv[2]));
+      return 0;
+    }
+    if (argc < 2) {
+      cerr << usage << endl;
+      return 1;
+    }
+    for (int i {2}; i < argc; ++i) {
+      string arg {argv[i]};
+      if (arg == "--binary")
+        binary = true;
+      else if (i + 1 < argc && arg == "--small")
+        rates.price_per_small_room = llround(stod(argv[++i]) * 100);
+      else if (i + 1 < argc && arg == "--large")
+        rates.price_per_large_room = llround(stod(argv[++i]) * 100);
+      else if (i + 1 < argc && arg == "--tax")
+        rates.sales_tax = llround(stod(argv[++i]) * 10000);
+      else if (i + 1 < argc && arg == "--expiry")
+        rates.estimate_expiry = stoi(argv[++i]);
+    }
+  } catch (const logic_error &) {       // invalid_argument and out_of_range
+    cerr << usage << endl;
+    return 1;
+  }
+  FILE *in = fopen(argv[1], "rb");
+  if (!in) {
+    cerr << "Error opening file " << argv[1] << endl;
+    return 1;
+  }
+  bool unpaired {false};
+  vector<Job> jobs = read_jobs(in, unpaired);
+  fclose(in);
+  if (unpaired)
+    cerr << "the last number in " << argv[1] << " has no partner - a job needs small and large rooms, that one was left out" << endl;
+
+  // every quote in the batch expires on the same day
+  time_t expires = time(nullptr) + static_cast<time_t>(rates.estimate_expiry) * 24 * 60 * 60;
+  char expiry_date[16];
+  strftime(expiry_date, sizeof(expiry_date), "%Y-%m-%d", localtime(&expires));
+  if (!binary)
+    cout << "# small\tlarge\tcost\ttax\ttotal - estimates valid until " << expiry_date << endl;
+
+  QuoteWriter writer {stdout, binary};
+  for (const auto &job: jobs)
+    writer.write(make_quote(job, rates));
+  return 0;
+}
+
 /***************************************************************************************************************************/
 
 /*
@@ -979,6 +1200,791 @@ movie_ratings[0][0] = 1; // This would update that specific element in the array
 cin >> movie_ratings[0][1]; // This would allow the user to update that specific element in the array.
 // the same characteristics hold for multidimensional arrays as for single-dimensional arrays. So we can use the sizeof operator to determine the size of the array in bytes. We can also use the subscript operator to access the elements of the array. We can also use the subscript operator to update the elements of the array.
 
+// multi-dimensional arrays - a ratings matrix with the size decided at runtime
+// int movie_ratings [3][4] needs rows and cols known at compile time, and a vector<vector<int>> puts every row in its own separate piece of memory. Real rating data is millions of reviewers by thousands of movies, read from a file. RatingsMatrix keeps all the ratings in one contiguous block, row after row (row-major, just like the built-in 2D array). Each row is padded to a multiple of 64 bytes and the block starts on a 64-byte boundary, so every row starts at the beginning of a cache line. row(r) gives a view of one reviewer's ratings without copying; col(c) gives a view of one movie's ratings that steps stride elements from row to row. Walking a column means touching one value per cache line, so per-movie aggregates are better done tile by tile: a block of rows and a block of columns at a time, moving along the rows inside the tile. for_each_tile() does that walk and column_means() uses it. Most reviewers only rate a few movies, though, and then storing every zero is a waste. SparseRatings is the compressed sparse row (CSR) form: for each reviewer only the movies they rated and the ratings, all in three flat arrays.
+// The aggregation kernels at the end (row sums and means, column sums and means, and the top k reviewers of every movie) split the matrix into tiles of rows and hand them to a small ThreadPool. Every thread adds its tiles into its own partial column sums, one column block at a time so the partial sums stay in cache, and the partial results are merged at the end - no locks while the work runs. The inner loops walk contiguous memory with no branches, so the compiler turns them into SIMD instructions (compile with -O3 -march=native). Run it with --benchmark [reviewers] [movies] to compare them with plain nested loops; the default 1,000,000 x 10,000 matrix of 1-byte ratings needs 10 GB of memory.
+// Finally, a matrix can live on disk. The file starts with a MatrixFileHeader (magic, version, element type, layout, rows, cols, row stride and where the data starts), followed by the rows exactly as they are laid out in memory: padded to whole cache lines, starting on a page boundary. MatrixWriter appends rows through an 8 MB buffer, so even a 40 GB file is written with large sequential writes and never has to fit in memory. MappedRatings checks the header (magic, element type, rows, cols, row stride, data offset) against the size of the file and then maps it into memory (mmap on Linux / macOS, CreateFileMapping on Windows, so it still builds with MinGW): nothing else is read up front, the operating system pages in only the parts a query touches, and row() and col() are views straight into the mapped file, with no copy. It can also map just a range of rows. MappedRatings has the same rows(), cols(), row() and (r, c) as RatingsMatrix, so the kernels above work on it unchanged. --write <file> <reviewers> <movies> writes a synthetic file, --open <file> [first_row last_row] maps it and runs the kernels.
+#include <iostream>
+#include <iomanip>
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <initializer_list>
+#include <stdexcept>
+#include <type_traits>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <limits>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <filesystem>
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX        // keep windows.h from defining min and max as macros
+#include <windows.h>    // CreateFileMapping, MapViewOfFile
+#else
+#include <fcntl.h>      // open
+#include <unistd.h>     // close, sysconf
+#include <sys/mman.h>   // mmap, munmap, madvise
+#endif
+using namespace std;
+
+constexpr size_t cache_line {64};
+
+// a row: contiguous, like an array
+template <typename T>
+class RowView {
+  T *first;
+  size_t count;
+public:
+  RowView(T *first, size_t count) : first{first}, count{count} {}
+  T *begin() const { return first; }
+  T *end() const { return first + count; }
+  T &operator[](size_t i) const { return first[i]; }
+  size_t size() const { return count; }
+};
+
+// a column: one element per row, stride elements apart
+template <typename T>
+class ColumnView {
+  T *first;
+  size_t count, stride;
+public:
+  class iterator {
+    T *p;
+    size_t stride;
+  public:
+    iterator(T *p, size_t stride) : p{p}, stride{stride} {}
+    T &operator*() const { return *p; }
+    iterator &operator++() { p += stride; return *this; }
+    bool operator!=(const iterator &other) const { return p != other.p; }
+  };
+  ColumnView(T *first, size_t count, size_t stride) : first{first}, count{count}, stride{stride} {}
+  iterator begin() const { return {first, stride}; }
+  iterator end() const { return {first + count * stride, stride}; }
+  T &operator[](size_t i) const { return first[i * stride]; }
+  size_t size() const { return count; }
+};
+
+template <typename T>
+class RatingsMatrix {
+  static_assert(is_arithmetic_v<T>, "ratings are numbers");
+public:
+  using value_type = T;
+private:
+  struct AlignedDelete {
+    void operator()(T *p) const { ::operator delete[](p, align_val_t {cache_line}); }
+  };
+  size_t row_count {0}, col_count {0}, row_stride {0};   // row_stride >= col_count, a whole number of cache lines
+  unique_ptr<T[], AlignedDelete> values;
+public:
+  RatingsMatrix(size_t rows, size_t cols, T value = T {})
+    : row_count{rows}, col_count{cols} {
+    const size_t per_line = cache_line / sizeof(T);
+    row_stride = (cols + per_line - 1) / per_line * per_line;
+    values.reset(static_cast<T *>(::operator new[](max<size_t>(1, rows * row_stride) * sizeof(T), align_val_t {cache_line})));
+    fill(values.get(), values.get() + rows * row_stride, value);
+  }
+  RatingsMatrix(initializer_list<initializer_list<T>> init)
+    : RatingsMatrix(init.size(), init.size() == 0 ? 0 : init.begin()->size()) {
+    size_t r {0};
+    for (const auto &row_values: init) {
+      if (row_values.size() != col_count)
+        throw invalid_argument {"every row needs the same number of ratings"};
+      copy(row_values.begin(), row_values.end(), row(r++).begin());
+    }
+  }
+  size_t rows() const { return row_count; }
+  size_t cols() const { return col_count; }
+  size_t stride() const { return row_stride; }
+  T *data() { return values.get(); }
+  const T *data() const { return values.get(); }
+
+  T &operator()(size_t r, size_t c) { return values[r * row_stride + c]; }
+  const T &operator()(size_t r, size_t c) const { return values[r * row_stride + c]; }
+  T &at(size_t r, size_t c) {
+    if (r >= row_count || c >= col_count)
+      throw out_of_range {"rating (" + to_string(r) + ", " + to_string(c) + ") is outside the matrix"};
+    return (*this)(r, c);
+  }
+  RowView<T> row(size_t r) { return {values.get() + r * row_stride, col_count}; }
+  RowView<const T> row(size_t r) const { return {values.get() + r * row_stride, col_count}; }
+  ColumnView<T> col(size_t c) { return {values.get() + c, row_count, row_stride}; }
+  ColumnView<const T> col(size_t c) const { return {values.get() + c, row_count, row_stride}; }
+
+  // calls visit(first_row, last_row, first_col, last_col) for every tile, tiles of one column block top to bottom
+  template <typename Visit>
+  void for_each_tile(size_t tile_rows, size_t tile_cols, Visit visit) const {
+    for (size_t c {0}; c < col_count; c += tile_cols)
+      for (size_t r {0}; r < row_count; r += tile_rows)
+        visit(r, min(r + tile_rows, row_count), c, min(c + tile_cols, col_count));
+  }
+  // per-movie average over all reviewers - the sums of one column block stay in cache while we go down the rows
+  vector<double> column_means(size_t tile_rows = 256, size_t tile_cols = 1024) const {
+    vector<double> sums(col_count);
+    for_each_tile(tile_rows, tile_cols, [&](size_t r0, size_t r1, size_t c0, size_t c1) {
+      for (size_t r {r0}; r < r1; ++r) {
+        const T *rating = values.get() + r * row_stride;
+        for (size_t c {c0}; c < c1; ++c)
+          sums[c] += rating[c];
+      }
+    });
+    for (auto &sum: sums)
+      sum = row_count == 0 ? 0 : sum / row_count;
+    return sums;
+  }
+};
+
+// compressed sparse row: reviewer r's ratings are movie[row_start[r] .. row_start[r+1]) and rating[...] at the same positions
+template <typename T>
+class SparseRatings {
+  size_t row_count {0}, col_count {0};
+  vector<size_t> row_start;
+  vector<uint32_t> movie;
+  vector<T> rating;
+public:
+  struct Entry {
+    uint32_t reviewer;
+    uint32_t movie;
+    T rating;
+  };
+  SparseRatings(size_t rows, size_t cols, vector<Entry> entries) : row_count{rows}, col_count{cols}, row_start(rows + 1) {
+    sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+      return a.reviewer != b.reviewer ? a.reviewer < b.reviewer : a.movie < b.movie;
+    });
+    movie.reserve(entries.size());
+    rating.reserve(entries.size());
+    for (const auto &entry: entries) {
+      if (entry.reviewer >= rows || entry.movie >= cols)
+        throw out_of_range {"rating outside the matrix"};
+      ++row_start[entry.reviewer + 1];
+      movie.push_back(entry.movie);
+      rating.push_back(entry.rating);
+    }
+    for (size_t r {0}; r < rows; ++r)    // counts -> starting positions
+      row_start[r + 1] += row_start[r];
+  }
+  // every rating that isn't `unrated` (0 by default) becomes an entry
+  static SparseRatings from_dense(const RatingsMatrix<T> &dense, T unrated = T {}) {
+    vector<Entry> entries;
+    for (size_t r {0}; r < dense.rows(); ++r)
+      for (size_t c {0}; c < dense.cols(); ++c)
+        if (dense(r, c) != unrated)
+          entries.push_back({static_cast<uint32_t>(r), static_cast<uint32_t>(c), dense(r, c)});
+    return SparseRatings {dense.rows(), dense.cols(), move(entries)};
+  }
+  size_t rows() const { return row_count; }
+  size_t cols() const { return col_count; }
+  size_t ratings() const { return rating.size(); }
+  RowView<const uint32_t> movies_of(size_t r) const { return {movie.data() + row_start[r], row_start[r + 1] - row_start[r]}; }
+  RowView<const T> ratings_of(size_t r) const { return {rating.data() + row_start[r], row_start[r + 1] - row_start[r]}; }
+  // per-movie average over the reviewers who rated it (0 if nobody did)
+  vector<double> column_means() const {
+    vector<double> sums(col_count);
+    vector<uint32_t> counts(col_count);
+    for (size_t i {0}; i < rating.size(); ++i) {
+      sums[movie[i]] += rating[i];
+      ++counts[movie[i]];
+    }
+    for (size_t c {0}; c < col_count; ++c)
+      sums[c] = counts[c] == 0 ? 0 : sums[c] / counts[c];
+    return sums;
+  }
+};
+
+// ThreadPool - the threads are started once and then run one parallel_for after another. parallel_for(count, work) calls work(index, worker) for every index in [0, count); the threads take the next index from an atomic counter, so fast threads simply take more tiles.
+class ThreadPool {
+  vector<thread> threads;
+  mutex m;
+  condition_variable wake, finished;
+  function<void(size_t, size_t)> job;
+  size_t job_count {0};
+  atomic<size_t> next_index {0};
+  size_t generation {0}, busy {0};
+  bool stopping {false};
+  void run(size_t worker) {
+    size_t seen {0};
+    while (true) {
+      {
+        unique_lock<mutex> lock {m};
+        wake.wait(lock, [&]() { return stopping || generation != seen; });
+        if (stopping)
+          return;
+        seen = generation;
+      }
+      for (size_t i = next_index++; i < job_count; i = next_index++)
+        job(i, worker);
+      unique_lock<mutex> lock {m};
+      if (--busy == 0)
+        finished.notify_one();
+    }
+  }
+public:
+  explicit ThreadPool(size_t count = thread::hardware_concurrency()) {
+    if (count == 0)
+      count = 1;
+    for (size_t worker {0}; worker < count; ++worker)
+      threads.emplace_back(&ThreadPool::run, this, worker);
+  }
+  ~ThreadPool() {
+    {
+      lock_guard<mutex> lock {m};
+      stopping = true;
+    }
+    wake.notify_all();
+    for (auto &t: threads)
+      t.join();
+  }
+  size_t size() const { return threads.size(); }
+  void parallel_for(size_t count, function<void(size_t, size_t)> work) {
+    unique_lock<mutex> lock {m};
+    job = move(work);
+    job_count = count;
+    next_index = 0;
+    busy = threads.size();
+    ++generation;
+    wake.notify_all();
+    finished.wait(lock, [&]() { return busy == 0; });
+  }
+};
+
+const size_t tile_rows {1024};          // rows per task
+const size_t tile_cols {4096};          // columns whose partial sums are kept hot at once
+
+// what the kernels add up in: double for floating point ratings, 64-bit integers of the same signedness otherwise
+template <typename T>
+using sum_type = conditional_t<is_floating_point_v<T>, double, conditional_t<is_signed_v<T>, int64_t, uint64_t>>;
+// one tile adds up at most tile_rows ratings per column: for ratings of up to 16 bits that fits in 32 bits, which vectorizes twice as wide
+template <typename T>
+using tile_sum_type = conditional_t<is_integral_v<T> && sizeof(T) <= 2, conditional_t<is_signed_v<T>, int32_t, uint32_t>, sum_type<T>>;
+
+// sum of every reviewer's ratings
+template <typename Matrix>
+auto row_sums(const Matrix &m, ThreadPool &pool) {
+  using Sum = sum_type<typename Matrix::value_type>;
+  vector<Sum> sums(m.rows());
+  size_t tiles = (m.rows() + tile_rows - 1) / tile_rows;
+  pool.parallel_for(tiles, [&](size_t tile, size_t) {
+    for (size_t r {tile * tile_rows}; r < min(m.rows(), (tile + 1) * tile_rows); ++r) {
+      Sum sum {0};
+      for (auto rating: m.row(r))       // contiguous - vectorizes
+        sum += rating;
+      sums[r] = sum;
+    }
+  });
+  return sums;
+}
+
+template <typename Matrix>
+vector<double> row_means(const Matrix &m, ThreadPool &pool) {
+  auto sums = row_sums(m, pool);
+  vector<double> means(sums.size());
+  for (size_t r {0}; r < sums.size(); ++r)
+    means[r] = m.cols() == 0 ? 0 : static_cast<double>(sums[r]) / m.cols();
+  return means;
+}
+
+// sum of every movie's ratings - each worker fills its own partial sums, tile by tile, then they are added up
+template <typename Matrix>
+auto column_sums(const Matrix &m, ThreadPool &pool) {
+  using T = typename Matrix::value_type;
+  using Sum = sum_type<T>;
+  vector<vector<Sum>> partial(pool.size(), vector<Sum>(m.cols()));
+  size_t tiles = (m.rows() + tile_rows - 1) / tile_rows;
+  pool.parallel_for(tiles, [&](size_t tile, size_t worker) {
+    Sum *sums = partial[worker].data();
+    size_t r0 = tile * tile_rows, r1 = min(m.rows(), r0 + tile_rows);
+    vector<tile_sum_type<T>> tile_sums(tile_cols);
+    for (size_t c0 {0}; c0 < m.cols(); c0 += tile_cols) {
+      size_t width = min(tile_cols, m.cols() - c0);
+      fill(tile_sums.begin(), tile_sums.end(), 0);
+      for (size_t r {r0}; r < r1; ++r) {
+        const auto *rating = &m(r, c0);
+        for (size_t c {0}; c < width; ++c)   // contiguous, no branches - vectorizes
+          tile_sums[c] += rating[c];
+      }
+      for (size_t c {0}; c < width; ++c)
+        sums[c0 + c] += tile_sums[c];
+    }
+  });
+  vector<Sum> sums(m.cols());
+  for (const auto &worker_sums: partial)
+    for (size_t c {0}; c < m.cols(); ++c)
+      sums[c] += worker_sums[c];
+  return sums;
+}
+
+template <typename Matrix>
+vector<double> column_means(const Matrix &m, ThreadPool &pool) {
+  auto sums = column_sums(m, pool);
+  vector<double> means(sums.size());
+  for (size_t c {0}; c < sums.size(); ++c)
+    means[c] = m.rows() == 0 ? 0 : static_cast<double>(sums[c]) / m.rows();
+  return means;
+}
+
+// the k best (rating, reviewer) pairs of a column - a higher rating wins, on a tie the lower reviewer number wins, so the answer never depends on the order the tiles were done in
+template <typename T>
+struct TopK {
+  struct Pick {
+    T rating;
+    uint32_t reviewer;
+    bool better_than(const Pick &other) const { return rating != other.rating ? rating > other.rating : reviewer < other.reviewer; }
+  };
+  vector<Pick> picks;                   // unordered, at most k
+  size_t worst {0};                     // index of the worst pick once we have k
+  void offer(const Pick &pick, size_t k) {
+    if (k == 0)
+      return;
+    if (picks.size() < k) {
+      picks.push_back(pick);
+      if (picks.size() == k)
+        find_worst();
+    } else if (pick.better_than(picks[worst])) {
+      picks[worst] = pick;
+      find_worst();
+    }
+  }
+  void find_worst() {
+    worst = 0;
+    for (size_t i {1}; i < picks.size(); ++i)
+      if (picks[worst].better_than(picks[i]))
+        worst = i;
+  }
+  vector<Pick> sorted() const {
+    vector<Pick> result {picks};
+    sort(result.begin(), result.end(), [](const Pick &a, const Pick &b) { return a.better_than(b); });
+    return result;
+  }
+};
+
+// top k reviewers of every movie - each worker keeps its own TopK per column. A worker sees its rows in increasing order, so a later tie never wins, and one compare against the k-th best rating so far skips almost every rating
+template <typename Matrix>
+auto top_k_per_column(const Matrix &m, size_t k, ThreadPool &pool) {
+  using T = typename Matrix::value_type;
+  if (k == 0)
+    return vector<vector<typename TopK<T>::Pick>>(m.cols());
+  vector<vector<TopK<T>>> partial(pool.size(), vector<TopK<T>>(m.cols()));
+  vector<vector<double>> admit_above(pool.size(), vector<double>(m.cols(), -numeric_limits<double>::infinity()));
+  size_t tiles = (m.rows() + tile_rows - 1) / tile_rows;
+  pool.parallel_for(tiles, [&](size_t tile, size_t worker) {
+    vector<TopK<T>> &tops = partial[worker];
+    double *threshold = admit_above[worker].data();
+    for (size_t r {tile * tile_rows}; r < min(m.rows(), (tile + 1) * tile_rows); ++r) {
+      const T *rating = &m(r, 0);
+      for (size_t c {0}; c < m.cols(); ++c)
+        if (rating[c] > threshold[c]) {
+          tops[c].offer({rating[c], static_cast<uint32_t>(r)}, k);
+          if (tops[c].picks.size() == k)
+            threshold[c] = tops[c].picks[tops[c].worst].rating;
+        }
+    }
+  });
+  vector<vector<typename TopK<T>::Pick>> result(m.cols());
+  for (size_t c {0}; c < m.cols(); ++c) {
+    TopK<T> merged;
+    for (const auto &tops: partial)
+      for (const auto &pick: tops[c].picks)
+        merged.offer(pick, k);
+    result[c] = merged.sorted();
+  }
+  return result;
+}
+
+template <typename Function>
+double time_seconds(Function function) {
+  auto start = chrono::steady_clock::now();
+  function();
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// the tiled, parallel kernels against plain nested loops on a synthetic matrix
+void benchmark(size_t reviewers, size_t movies) {
+  cout << "filling a " << reviewers << " x " << movies << " matrix..." << endl;
+  RatingsMatrix<uint8_t> m {reviewers, movies};
+  ThreadPool pool;
+  pool.parallel_for((reviewers + tile_rows - 1) / tile_rows, [&](size_t tile, size_t) {
+    uint64_t state {tile * 0x9e3779b97f4a7c15ULL + 1};
+    for (size_t r {tile * tile_rows}; r < min(reviewers, (tile + 1) * tile_rows); ++r)
+      for (auto &rating: m.row(r)) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        rating = static_cast<uint8_t>((state >> 59) % 6);   // 0 (not rated) to 5
+      }
+  });
+
+  vector<uint64_t> naive_rows(reviewers), naive_cols(movies);
+  double naive_row_time = time_seconds([&]() {
+    for (size_t r {0}; r < reviewers; ++r)
+      for (size_t c {0}; c < movies; ++c)
+        naive_rows[r] += m(r, c);
+  });
+  double naive_col_time = time_seconds([&]() {     // column by column - a stride of a whole row between reads
+    for (size_t c {0}; c < movies; ++c)
+      for (size_t r {0}; r < reviewers; ++r)
+        naive_cols[c] += m(r, c);
+  });
+  vector<uint64_t> rows, cols;
+  double row_time = time_seconds([&]() { rows = row_sums(m, pool); });
+  double col_time = time_seconds([&]() { cols = column_sums(m, pool); });
+  double top_time = time_seconds([&]() { top_k_per_column(m, 10, pool); });
+
+  cout << fixed << setprecision(3);
+  cout << "row sums    - naive: " << naive_row_time << " s, tiled: " << row_time << " s" << (rows == naive_rows ? "" : "  MISMATCH") << endl;
+  cout << "column sums - naive: " << naive_col_time << " s, tiled: " << col_time << " s" << (cols == naive_cols ? "" : "  MISMATCH") << endl;
+  cout << "top 10 per column  : " << top_time << " s on " << pool.size() << " thread(s)" << endl;
+}
+
+// the on-disk format - all numbers in the byte order of the machine that wrote the file (little-endian on x86 and ARM), so the rows can be mapped and used with no conversion. A machine with the other byte order reads version 1 as 16777216 and refuses the file. The rows start at data_offset
+struct MatrixFileHeader {
+  char magic[8];                        // "RATINGS" and a 0
+  uint32_t version;                     // 1
+  uint32_t dtype;                       // element type, see dtype_of()
+  uint32_t layout;                      // 0 = row-major, every row padded to row_stride elements
+  uint32_t element_size;                // bytes per element
+  uint64_t rows;
+  uint64_t cols;
+  uint64_t row_stride;                  // elements from one row to the next
+  uint64_t data_offset;                 // bytes from the start of the file to row 0, a multiple of 4096
+};
+const char matrix_magic[8] {'R', 'A', 'T', 'I', 'N', 'G', 'S', 0};
+const uint64_t matrix_data_offset {4096};
+
+template <typename T>
+constexpr uint32_t dtype_of() {
+  if constexpr (is_same_v<T, uint8_t>) return 1;
+  else if constexpr (is_same_v<T, int8_t>) return 2;
+  else if constexpr (is_same_v<T, uint16_t>) return 3;
+  else if constexpr (is_same_v<T, int16_t>) return 4;
+  else if constexpr (is_same_v<T, int32_t>) return 5;
+  else if constexpr (is_same_v<T, float>) return 6;
+  else if constexpr (is_same_v<T, double>) return 7;
+  else return 0;
+}
+
+// writes a matrix file row by row through a large buffer - the whole matrix never has to be in memory
+template <typename T>
+class MatrixWriter {
+  static_assert(dtype_of<T>() != 0, "no file type code for this element type");
+  FILE *out;
+  MatrixFileHeader header {};
+  vector<char> buffer;
+  size_t used {0};
+  uint64_t rows_written {0};
+  void flush() {
+    if (fwrite(buffer.data(), 1, used, out) != used)
+      throw runtime_error {string {"write failed: "} + strerror(errno)};
+    used = 0;
+  }
+public:
+  MatrixWriter(const string &file_name, uint64_t rows, uint64_t cols, size_t buffer_size = 8 << 20) : buffer(buffer_size) {
+    out = fopen(file_name.c_str(), "wb");
+    if (!out)
+      throw runtime_error {"can't create " + file_name + ": " + strerror(errno)};
+    const uint64_t per_line = cache_line / sizeof(T);
+    copy(begin(matrix_magic), end(matrix_magic), header.magic);
+    header.version = 1;
+    header.dtype = dtype_of<T>();
+    header.layout = 0;
+    header.element_size = sizeof(T);
+    header.rows = rows;
+    header.cols = cols;
+    header.row_stride = (cols + per_line - 1) / per_line * per_line;
+    header.data_offset = matrix_data_offset;
+    const char *bytes = reinterpret_cast<const char *>(&header);
+    copy(bytes, bytes + sizeof(header), buffer.data());
+    used = matrix_data_offset;          // the rest of the first page stays zero
+    fill(buffer.data() + sizeof(header), buffer.data() + used, 0);
+  }
+  ~MatrixWriter() {
+    if (out)
+      fclose(out);
+  }
+  MatrixWriter(const MatrixWriter &) = delete;
+  MatrixWriter &operator=(const MatrixWriter &) = delete;
+  // cols values, the padding is added here
+  void append_row(const T *values) {
+    const size_t row_bytes = header.row_stride * sizeof(T);
+    if (buffer.size() - used < row_bytes)
+      flush();
+    if (row_bytes > buffer.size())
+      buffer.resize(row_bytes);
+    char *p = buffer.data() + used;
+    const char *bytes = reinterpret_cast<const char *>(values);
+    copy(bytes, bytes + header.cols * sizeof(T), p);
+    fill(p + header.cols * sizeof(T), p + row_bytes, 0);
+    used += row_bytes;
+    ++rows_written;
+  }
+  void close() {
+    if (rows_written != header.rows)
+      throw runtime_error {"wrote " + to_string(rows_written) + " rows, the header says " + to_string(header.rows)};
+    flush();
+    if (fclose(out) != 0)
+      throw runtime_error {string {"close failed: "} + strerror(errno)};
+    out = nullptr;
+  }
+};
+
+template <typename T>
+void save_matrix(const RatingsMatrix<T> &m, const string &file_name) {
+  MatrixWriter<T> writer {file_name, m.rows(), m.cols()};
+  for (size_t r {0}; r < m.rows(); ++r)
+    writer.append_row(m.row(r).begin());
+  writer.close();
+}
+
+// a read-only, zero-copy view of a matrix file (or of rows [first_row, last_row) of it)
+template <typename T>
+class MappedRatings {
+  void *mapping {nullptr};
+  size_t mapping_size {0};
+  const T *first {nullptr};             // row first_row
+  uint64_t row_count {0}, col_count {0}, row_stride {0}, first_row_number {0};
+
+  // size bytes of the file from offset, which has to be a multiple of map_granularity(). The view stays valid after the file is closed.
+#if defined(_WIN32)
+  static uint64_t map_granularity() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwAllocationGranularity;
+  }
+  static void *map(const string &file_name, uint64_t offset, size_t size) {
+    HANDLE file = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+      throw runtime_error {"can't open " + file_name};
+    HANDLE file_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void *view = file_mapping ? MapViewOfFile(file_mapping, FILE_MAP_READ, static_cast<DWORD>(offset >> 32), static_cast<DWORD>(offset), size) : nullptr;
+    DWORD error = GetLastError();
+    if (file_mapping)
+      CloseHandle(file_mapping);          // the view keeps the mapping alive
+    CloseHandle(file);
+    if (!view)
+      throw runtime_error {"can't map " + file_name + ": error " + to_string(error)};
+    return view;
+  }
+  static void unmap(void *view, size_t) { UnmapViewOfFile(view); }
+#else
+  static uint64_t map_granularity() { return sysconf(_SC_PAGESIZE); }
+  static void *map(const string &file_name, uint64_t offset, size_t size) {
+    int fd = ::open(file_name.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw runtime_error {"can't open " + file_name + ": " + strerror(errno)};
+    void *view = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, static_cast<off_t>(offset));
+    int error = errno;
+    ::close(fd);
+    if (view == MAP_FAILED)
+      throw runtime_error {"mmap failed: " + string {strerror(error)}};
+    return view;
+  }
+  static void unmap(void *view, size_t size) { munmap(view, size); }
+#endif
+
+public:
+  using value_type = T;
+  explicit MappedRatings(const string &file_name, uint64_t first_row = 0, uint64_t last_row = UINT64_MAX) {
+    FILE *in = fopen(file_name.c_str(), "rb");
+    if (!in)
+      throw runtime_error {"can't open " + file_name + ": " + strerror(errno)};
+    MatrixFileHeader header {};
+    bool header_read = fread(&header, sizeof(header), 1, in) == 1;
+    fclose(in);
+    if (!header_read || memcmp(header.magic, matrix_magic, sizeof(matrix_magic)) != 0 || header.version != 1 || header.layout != 0)
+      throw runtime_error {file_name + " is not a ratings matrix file (or was written on a machine with the other byte order)"};
+    if (header.dtype != dtype_of<T>() || header.element_size != sizeof(T))
+      throw runtime_error {file_name + " holds a different element type"};
+    // every size in the header is checked against the file before it is used, written so that nothing can overflow
+    error_code ec;
+    const uint64_t file_size = filesystem::file_size(file_name, ec);
+    if (ec)
+      throw runtime_error {"can't read the size of " + file_name + ": " + ec.message()};
+    if (header.cols > header.row_stride || header.data_offset < sizeof(header) || header.data_offset % matrix_data_offset != 0)
+      throw runtime_error {file_name + " has a damaged header"};
+    const uint64_t data_size = file_size - min(file_size, header.data_offset);
+    if (header.row_stride > data_size / sizeof(T) || (header.row_stride != 0 && header.rows > data_size / (header.row_stride * sizeof(T))))
+      throw runtime_error {file_name + " is shorter than its header says"};
+    const uint64_t row_bytes = header.row_stride * sizeof(T);
+    last_row = min(last_row, header.rows);
+    first_row = min(first_row, last_row);
+    row_count = last_row - first_row;
+    col_count = header.cols;
+    row_stride = header.row_stride;
+    first_row_number = first_row;
+    if (row_count != 0 && row_bytes != 0) {
+      // the offset of a mapping must be aligned (to a page, 64 KB on Windows), so map from the aligned start before the first row
+      const uint64_t granularity = map_granularity();
+      const uint64_t start = header.data_offset + first_row * row_bytes;
+      const uint64_t aligned_start = start / granularity * granularity;
+      mapping_size = start - aligned_start + row_count * row_bytes;
+      mapping = map(file_name, aligned_start, mapping_size);
+      first = reinterpret_cast<const T *>(static_cast<const char *>(mapping) + (start - aligned_start));
+    }
+  }
+  ~MappedRatings() {
+    if (mapping)
+      unmap(mapping, mapping_size);
+  }
+  MappedRatings(const MappedRatings &) = delete;
+  MappedRatings &operator=(const MappedRatings &) = delete;
+
+  // tell the OS how we are going to read, so it can read ahead (sequential) or not (random) - Windows decides by itself
+  void advise([[maybe_unused]] bool sequential) const {
+#if !defined(_WIN32)
+    if (mapping)
+      madvise(mapping, mapping_size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+#endif
+  }
+  size_t rows() const { return row_count; }
+  size_t cols() const { return col_count; }
+  uint64_t first_row() const { return first_row_number; }   // row 0 of this view is this row of the file
+  const T &operator()(size_t r, size_t c) const { return first[r * row_stride + c]; }
+  RowView<const T> row(size_t r) const { return {first + r * row_stride, col_count}; }
+  ColumnView<const T> col(size_t c) const { return {first + c, row_count, row_stride}; }
+};
+
+int main(int argc, char *argv[]) {
+  if (argc == 5 && string {argv[1]} == "--write") {
+    // a synthetic matrix of 1-byte ratings, generated and written one row at a time
+    try {
+      uint64_t reviewers = stoull(argv[3]), movies = stoull(argv[4]);
+      MatrixWriter<uint8_t> writer {argv[2], reviewers, movies};
+      vector<uint8_t> ratings(movies);
+      uint64_t state {42};
+      for (uint64_t r {0}; r < reviewers; ++r) {
+        for (auto &rating: ratings) {
+          state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+          rating = static_cast<uint8_t>((state >> 59) % 6);
+        }
+        writer.append_row(ratings.data());
+      }
+      writer.close();
+    } catch (const exception &ex) {
+      cerr << ex.what() << endl;
+      return 1;
+    }
+    return 0;
+  }
+  if (argc >= 3 && string {argv[1]} == "--open") {
+    try {
+      auto start = chrono::steady_clock::now();
+      MappedRatings<uint8_t> mapped {argv[2], argc > 3 ? stoull(argv[3]) : 0, argc > 4 ? stoull(argv[4]) : UINT64_MAX};
+      double open_time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+      mapped.advise(true);
+      ThreadPool pool;
+      vector<double> means;
+      double mean_time = time_seconds([&]() { means = column_means(mapped, pool); });
+      cout << fixed << setprecision(3);
+      cout << "mapped rows " << mapped.first_row() << " to " << mapped.first_row() + mapped.rows() << " of " << argv[2] << " (" << mapped.cols() << " movies) in " << open_time * 1000 << " ms" << endl;
+      cout << "per-movie averages in " << mean_time << " s, movie #1: " << (means.empty() ? 0.0 : means[0]) << endl;
+    } catch (const exception &ex) {
+      cerr << ex.what() << endl;
+      return 1;
+    }
+    return 0;
+  }
+  if (argc > 1 && string {argv[1]} == "--benchmark") {
+    benchmark(argc > 2 ? stoull(argv[2]) : 1'000'000, argc > 3 ? stoull(argv[3]) : 10'000);
+    return 0;
+  }
+
+  RatingsMatrix<int> movie_ratings {   // 3 reviewers, 4 movies, like the array above
+    {0, 4, 3, 5},
+    {2, 3, 3, 5},
+    {1, 4, 4, 5}
+  };
+  cout << "rows: " << movie_ratings.rows() << ", cols: " << movie_ratings.cols() << ", stride: " << movie_ratings.stride() << endl;
+  cout << movie_ratings(0, 1) << endl;  // 4
+  movie_ratings.at(0, 0) = 1;           // updating an element, with bounds checking
+
+  cout << "\nreviewer #1 :";
+  for (int rating: movie_ratings.row(0))
+    cout << " " << rating;
+  cout << "\nmovie #3    :";
+  for (int rating: movie_ratings.col(2))
+    cout << " " << rating;
+  cout << endl;
+
+  cout << fixed << setprecision(2) << "\nper-movie averages :";
+  for (double mean: movie_ratings.column_means())
+    cout << " " << mean;
+  cout << endl;
+
+  // a bigger one: 200,000 reviewers x 2,000 movies, each reviewer rated about 20 movies (1%)
+  const size_t reviewers {200'000}, movies {2'000};
+  vector<SparseRatings<uint8_t>::Entry> entries;
+  uint64_t state {7};
+  for (uint32_t r {0}; r < reviewers; ++r)
+    for (int k {0}; k < 20; ++k) {
+      state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+      entries.push_back({r, static_cast<uint32_t>((state >> 33) % movies), static_cast<uint8_t>(1 + (state >> 20) % 5)});
+    }
+  SparseRatings<uint8_t> sparse {reviewers, movies, entries};
+  cout << "\nsparse: " << sparse.ratings() << " ratings in " << (sparse.ratings() * (sizeof(uint32_t) + sizeof(uint8_t)) + (reviewers + 1) * sizeof(size_t)) / 1e6
+       << " MB, the dense matrix would need " << reviewers * movies * sizeof(uint8_t) / 1e6 << " MB" << endl;
+  cout << "average rating of movie #1 : " << sparse.column_means()[0] << endl;
+
+  // the parallel kernels on the small matrix
+  ThreadPool pool;
+  cout << "\nper-reviewer averages :";
+  for (double mean: row_means(movie_ratings, pool))
+    cout << " " << mean;
+  cout << "\nper-movie averages    :";
+  for (double mean: column_means(movie_ratings, pool))
+    cout << " " << mean;
+  cout << "\ntop 2 reviewers of each movie :";
+  for (const auto &picks: top_k_per_column(movie_ratings, 2, pool)) {
+    cout << " [";
+    for (const auto &pick: picks)
+      cout << " #" << pick.reviewer + 1 << "=" << pick.rating;
+    cout << " ]";
+  }
+  cout << endl;
+
+  // the kernels add up in a type that fits the ratings: double for float, signed 64 bits for int
+  RatingsMatrix<float> scores {
+    {-1.5f, 2.25f, 0.5f},
+    {3.0f, -0.75f, -2.5f}
+  };
+  cout << "\nscore sums per reviewer :";
+  for (double sum: row_sums(scores, pool))
+    cout << " " << sum;                 // 1.25 -0.25
+  cout << "\nscore sums per movie    :";
+  for (double sum: column_sums(scores, pool))
+    cout << " " << sum;                 // 1.50 1.50 -2.00
+  cout << "\ntop 0 reviewers of each movie: " << top_k_per_column(scores, 0, pool)[0].size() << endl;
+
+  // save the small matrix to a temporary file and map it back
+  const string file_name {(filesystem::temp_directory_path() / "movie_ratings.bin").string()};
+  save_matrix(movie_ratings, file_name);
+  {
+    MappedRatings<int> mapped {file_name};
+    cout << "\nmapped from " << file_name << ", reviewer #3 :";
+    for (int rating: mapped.row(2))
+      cout << " " << rating;
+    cout << endl;
+  }
+  // a file cut short is refused when it is opened, not found out by a crash in a kernel
+  filesystem::resize_file(file_name, matrix_data_offset + 8);
+  try {
+    MappedRatings<int> truncated {file_name};
+    cout << "a truncated file was mapped - it should have been refused" << endl;
+    filesystem::remove(file_name);
+    return 1;
+  } catch (const runtime_error &ex) {
+    cout << "truncated file refused: " << ex.what() << endl;
+  }
+  filesystem::remove(file_name);
+  return 0;
+}
+
 /***************************************************************************************************************************/
 
 /*
@@ -1769,6 +2775,286 @@ int main() {
   return 0;
 }
 
+// Convert EUR to USD - a bulk converter for whole ledgers
+// Multiplying a double by 1.19 is fine for one value, but a ledger has millions of amounts in many currencies, and doubles can't hold most decimal amounts exactly (0.10 is really 0.1000000000000000055...), so the cents start to drift when you add up a lot of converted values. This converter keeps every amount in whole cents (long long) and every rate as a fixed-point integer with 6 decimals (1.19 is 1190000), so the conversion is an integer multiply, an add of half the scale for rounding and a divide by 1000000 - the same result on every machine, every run. The rate table (FROM TO RATE per line) is loaded once. The ledger (FROM,TO,AMOUNT per line) is streamed in blocks of 64K records, so a file of any size runs in the same small amount of memory. For every block we first look up the rate of each record into a rate column, then convert the whole amount column with one branch-free loop: the divide by 1000000 is replaced by a double estimate and an exact integer correction, which vectorizes where the CPU can convert 64-bit integers to double (AVX-512) and is still about twice as fast as a divide where it can't (AVX2). If an amount is so large that amount * rate could overflow 64 bits, that block takes an exact 128-bit path instead, and a line whose converted amount doesn't fit in 64 bits is skipped and reported rather than truncated. Run with --check to test the edge cases.
+// usage: ledger_convert <rates file> <ledger file>    output: FROM,TO,AMOUNT,CONVERTED per line
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <charconv>
+using namespace std;
+
+const int64_t rate_scale {1'000'000};   // rates have 6 decimals
+const int64_t too_large {INT64_MIN};    // a converted amount that doesn't fit in 64 bits - never a real result, those stay within +-INT64_MAX
+
+class RateTable {
+  unordered_map<string, int64_t> rates;   // "EURUSD" -> 1190000
+public:
+  bool load(const string &file_name) {
+    ifstream in_file {file_name};
+    if (!in_file)
+      return false;
+    string line;
+    int line_number {0};
+    while (getline(in_file, line)) {    // a bad line is reported and skipped, the lines after it still count
+      ++line_number;
+      istringstream iss {line};
+      string from, to, extra;
+      double rate {};
+      if (!(iss >> from))
+        continue;                       // an empty line
+      if (!(iss >> to >> rate) || iss >> extra || !(rate > 0) || rate * rate_scale > INT64_MAX / 2) {
+        cerr << file_name << " line " << line_number << ": can't read \"" << line << "\"" << endl;
+        continue;
+      }
+      rates[from + to] = llround(rate * rate_scale);
+    }
+    return true;
+  }
+  // 0 when the pair isn't in the table
+  int64_t rate(string_view from, string_view to) const {
+    string key {from};
+    key += to;
+    auto it = rates.find(key);
+    return it == rates.end() ? 0 : it->second;
+  }
+};
+
+// "1234.5" -> 123450 cents, "-0.07" -> -7 - amounts up to a quadrillion (10^15) in either direction
+bool parse_cents(string_view text, int64_t &cents) {
+  bool negative = !text.empty() && text[0] == '-';
+  if (negative)
+    text.remove_prefix(1);
+  size_t dot = text.find('.');
+  int64_t whole {0}, fraction {0};
+  string_view whole_part = text.substr(0, dot);
+  if (whole_part.empty() || whole_part[0] < '0' || whole_part[0] > '9')
+    return false;                       // from_chars would take a second sign: "--5.00"
+  if (from_chars(whole_part.data(), whole_part.data() + whole_part.size(), whole).ptr != whole_part.data() + whole_part.size())
+    return false;
+  if (whole > 1'000'000'000'000'000)
+    return false;
+  if (dot != string_view::npos) {
+    string_view fraction_part = text.substr(dot + 1);
+    if (fraction_part.size() > 2)
+      return false;                     // ledgers are in cents
+    for (char c: fraction_part) {
+      if (c < '0' || c > '9')
+        return false;
+      fraction = fraction * 10 + (c - '0');
+    }
+    if (fraction_part.size() == 1)
+      fraction *= 10;
+  }
+  cents = whole * 100 + fraction;
+  if (negative)
+    cents = -cents;
+  return true;
+}
+
+char *write_cents(char *p, char *end, int64_t cents) {
+  if (cents < 0) {
+    *p++ = '-';
+    cents = -cents;
+  }
+  p = to_chars(p, end, cents / 100).ptr;
+  *p++ = '.';
+  *p++ = static_cast<char>('0' + cents % 100 / 10);
+  *p++ = static_cast<char>('0' + cents % 10);
+  return p;
+}
+
+// converted[i] = amount[i] * rate[i] / rate_scale, rounded half away from zero, or too_large
+void convert_block(const int64_t *amount, const int64_t *rate, int64_t *converted, size_t count) {
+  int64_t largest_amount {0}, largest_rate {0};
+  const double inverse_scale {1.0 / rate_scale};
+  for (size_t i {0}; i < count; ++i) {  // one cheap pass to see if the 64-bit products are safe
+    int64_t a = amount[i] < 0 ? -amount[i] : amount[i];
+    largest_amount = a > largest_amount ? a : largest_amount;
+    largest_rate = rate[i] > largest_rate ? rate[i] : largest_rate;
+  }
+  if (largest_rate == 0 || largest_amount <= (INT64_MAX - 4 * rate_scale) / largest_rate) {
+    // the fast path: no 64-bit divide. The quotient is estimated in double and corrected with exact integer math, like split_batch.
+    // With -O3 -march=x86-64-v4 this vectorizes; AVX2 has no int64 <-> double conversion, so with -march=x86-64-v3 it stays scalar (still about 2x faster than the divide)
+    for (size_t i {0}; i < count; ++i) {
+      int64_t product = amount[i] * rate[i];
+      int64_t sign = product >> 63;     // 0 or -1: round the magnitude, then put the sign back
+      int64_t rounded = ((product ^ sign) - sign) + rate_scale / 2;
+      int64_t quotient = static_cast<int64_t>(static_cast<double>(rounded) * inverse_scale);
+      quotient -= quotient * rate_scale > rounded;          // the estimate can be one off either way
+      quotient += (quotient + 1) * rate_scale <= rounded;
+      converted[i] = (quotient ^ sign) - sign;
+    }
+  } else {
+    for (size_t i {0}; i < count; ++i) {  // the exact path for huge amounts
+      __int128 product = static_cast<__int128>(amount[i]) * rate[i];
+      __int128 half = product < 0 ? -rate_scale / 2 : rate_scale / 2;
+      __int128 result = (product + half) / rate_scale;
+      converted[i] = (result > INT64_MAX || result < -INT64_MAX) ? too_large : static_cast<int64_t>(result);
+    }
+  }
+}
+
+// the edges of convert_block: rounding both ways, the largest amounts that fit, and ones that don't
+bool check() {
+  struct Case {
+    int64_t amount, rate, expected;
+  };
+  const Case cases[] {
+    {150, 1'190'000, 179},                // 1.785 rounds up
+    {-150, 1'190'000, -179},              // and down, away from zero
+    {1, 500'000, 1},
+    {INT64_MAX, 1'000'000, INT64_MAX},    // the exact path, still fits
+    {-INT64_MAX, 1'000'000, -INT64_MAX},
+    {INT64_MAX / 2 + 1, 2'000'000, too_large},
+    {1'000'000'000'000'000, 100'000'000'000, too_large},
+    {-INT64_MAX, 3'000'000, too_large},
+    {1'000'000'003'995, 9'223'372, 9'223'372'036'847},   // the largest amount on the fast path at this rate
+    {-1'000'000'003'995, 9'223'372, -9'223'372'036'847},
+  };
+  bool ok {true};
+  for (const Case &c : cases) {
+    int64_t converted;
+    convert_block(&c.amount, &c.rate, &converted, 1);
+    if (converted != c.expected) {
+      cout << "FAILED: " << c.amount << " at rate " << c.rate << " gave " << converted << ", expected " << c.expected << endl;
+      ok = false;
+    }
+  }
+  struct Text {
+    const char *amount;
+    bool valid;
+    int64_t cents;
+  };
+  const Text texts[] {
+    {"1234.5", true, 123450},
+    {"-0.07", true, -7},
+    {"--5.00", false, 0},               // not +500
+    {"-+5", false, 0},
+    {"+5", false, 0},
+    {"5.123", false, 0},
+    {"", false, 0},
+  };
+  for (const Text &t : texts) {
+    int64_t cents {0};
+    bool valid = parse_cents(t.amount, cents);
+    if (valid != t.valid || (valid && cents != t.cents)) {
+      cout << "FAILED: \"" << t.amount << "\" read as " << (valid ? to_string(cents) + " cents" : "invalid") << endl;
+      ok = false;
+    }
+  }
+  cout << (ok ? "all conversions correct" : "some conversions FAILED") << endl;
+  return ok;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc == 2 && string_view {argv[1]} == "--check")
+    return check() ? 0 : 1;
+  if (argc < 3) {
+    cerr << "usage: " << argv[0] << " <rates file> <ledger file>  (or --check)" << endl;
+    return 1;
+  }
+  RateTable table;
+  if (!table.load(argv[1])) {
+    cerr << "Error opening file " << argv[1] << endl;
+    return 1;
+  }
+  FILE *in = fopen(argv[2], "rb");
+  if (!in) {
+    cerr << "Error opening file " << argv[2] << endl;
+    return 1;
+  }
+
+  const size_t block_records {65536};
+  vector<string_view> lines;            // the FROM,TO,AMOUNT text of each record, to echo it back
+  vector<int64_t> amount(block_records), rate(block_records), converted(block_records);
+  vector<char> input(1 << 22), output(1 << 22);
+  size_t carried {0};                   // bytes of an unfinished line kept from the previous read
+  size_t out_used {0};
+  size_t bad_lines {0}, too_large_lines {0};
+
+  auto flush_records = [&]() {
+    convert_block(amount.data(), rate.data(), converted.data(), lines.size());
+    for (size_t i {0}; i < lines.size(); ++i) {
+      if (converted[i] == too_large) {
+        ++too_large_lines;
+        continue;
+      }
+      if (output.size() - out_used < lines[i].size() + 32) {
+        fwrite(output.data(), 1, out_used, stdout);
+        out_used = 0;
+      }
+      char *p = copy(lines[i].begin(), lines[i].end(), output.data() + out_used);
+      *p++ = ',';
+      p = write_cents(p, output.data() + output.size(), converted[i]);
+      *p++ = '\n';
+      out_used = p - output.data();
+    }
+    lines.clear();
+  };
+
+  while (true) {
+    size_t read = fread(input.data() + carried, 1, input.size() - carried, in);
+    size_t filled = carried + read;
+    if (filled == 0)
+      break;
+    size_t end_of_lines = filled;       // only whole lines are processed, the rest is carried to the next read
+    if (read != 0) {
+      while (end_of_lines > 0 && input[end_of_lines - 1] != '\n')
+        --end_of_lines;
+      if (end_of_lines == 0) {
+        cerr << "line longer than the input buffer" << endl;
+        return 1;
+      }
+    }
+    string_view text {input.data(), end_of_lines};
+    while (!text.empty()) {
+      size_t newline = text.find('\n');
+      string_view line = text.substr(0, newline);
+      text.remove_prefix(newline == string_view::npos ? text.size() : newline + 1);
+      if (!line.empty() && line.back() == '\r')
+        line.remove_suffix(1);
+      size_t comma1 = line.find(',');
+      size_t comma2 = comma1 == string_view::npos ? comma1 : line.find(',', comma1 + 1);
+      int64_t cents {0};
+      if (comma2 == string_view::npos || !parse_cents(line.substr(comma2 + 1), cents)) {
+        if (!line.empty())
+          ++bad_lines;
+        continue;
+      }
+      int64_t pair_rate = table.rate(line.substr(0, comma1), line.substr(comma1 + 1, comma2 - comma1 - 1));
+      if (pair_rate == 0) {
+        ++bad_lines;
+        continue;
+      }
+      amount[lines.size()] = cents;
+      rate[lines.size()] = pair_rate;
+      lines.push_back(line);
+      if (lines.size() == block_records)
+        flush_records();
+    }
+    flush_records();                    // the lines point into input, so finish them before it's reused
+    carried = filled - end_of_lines;
+    copy(input.begin() + end_of_lines, input.begin() + filled, input.begin());
+    if (read == 0)
+      break;
+  }
+  fwrite(output.data(), 1, out_used, stdout);
+  fclose(in);
+  if (bad_lines != 0)
+    cerr << bad_lines << " line(s) skipped - unknown currency pair or bad amount" << endl;
+  if (too_large_lines != 0)
+    cerr << too_large_lines << " line(s) skipped - the converted amount is too large for 64 bits" << endl;
+  return too_large_lines == 0 ? 0 : 1;
+}
+
 /*
 Using the Assignment Operator
 
@@ -2316,60 +3602,479 @@ int main() {
   return 0;
 }
 
-/***************************************************************************************************************************/
+// challenge - batch change making
+// The programs above make change for one amount typed at the keyboard. Here the same greedy steps (as many dollars as fit, then quarters, and so on) are run over a whole file of amounts, tens of millions of them. Three things make it fast. First, a division by a constant can be replaced by a multiplication and a shift: for amounts below 2^31, amount / d == (amount * m) >> s with s = 31 + ceil(log2 d) and m = ceil(2^s / d), which is exactly what the compiler does when d is a literal. Here the denominations come from a table at runtime, so we work out m and s ourselves once per coin. Second, the amounts are processed in chunks and each coin is one simple loop over the whole chunk with no branches, so the compiler can turn it into SIMD instructions (compile with -O3 -march=native). Third, the input is read in large blocks and the output is formatted with to_chars into a large buffer, no cin >> or endl per amount. The denomination table is pluggable: pass your own currency system with --table name=value,name=value,...
+// usage: change_batch <amounts file> [--totals] [--table dollars=100,quarters=25,dimes=10,nickels=5,pennies=1]
+#include <iostream>
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <charconv>
+#include <algorithm>
+#include <stdexcept>
+using namespace std;
 
-//  control structures: that allow you to control the flow of execution in your program. So far you've learned how to write programs that run sequentially that is one statement followed by another and so forth. You can solve many problems using sequence. But now is when we really take advantage of the power of programming. we'll go over the selection and iteration control structures in c++. Selection control structures allow you to make decisions and execute parts of your program only when certain conditions are true or false. This is so powerful and opens up a world of programming power. So we have these three basic programming building blocks: sequence, selection and iteration. With sequence, selection and iteration, we can implement any algorithm, Let me repeat that: with sequence, selection and iteration, we can implement any algorithm.
+struct Denomination {
+  string name;
+  uint32_t value;           // in cents
+  uint64_t multiplier;      // amount / value == (amount * multiplier) >> shift for any amount < 2^31
+  int shift;
+};
 
-// if statement - The if statement is the most basic selection statement. It allows you to execute a statement or a group of statements only if a particular condition is true. The syntax of the if statement is:
-if (condition)
-  statement;
-if(num > 10) { // A block statement is a sequence of statements inside a block which is made up of opening and closing curly brackets.
-  cout << "num is greater than 10" << endl;
-  cout << "I'm in the if block" << endl;
+Denomination make_denomination(const string &name, uint32_t value) {
+  int log2_value {0};       // ceil(log2(value))
+  while ((uint64_t{1} << log2_value) < value)
+    ++log2_value;
+  int shift = 31 + log2_value;
+  uint64_t multiplier = ((uint64_t{1} << shift) + value - 1) / value;
+  return {name, value, multiplier, shift};
+}
+
+// parse "dollars=100,quarters=25,..." - the coins are used largest first
+vector<Denomination> parse_table(const string &spec) {
+  vector<Denomination> table;
+  size_t start {0};
+  while (start < spec.size()) {
+    size_t comma = spec.find(',', start);
+    if (comma == string::npos)
+      comma = spec.size();
+    string entry = spec.substr(start, comma - start);
+    size_t equals = entry.find('=');
+    if (equals == string::npos || equals + 1 == entry.size() || entry[equals + 1] < '0' || entry[equals + 1] > '9')
+      throw invalid_argument {"bad denomination: " + entry};   // stoul would take "-5" and wrap it around
+    unsigned long long value = stoull(entry.substr(equals + 1));
+    if (value == 0 || value > UINT32_MAX)
+      throw invalid_argument {"bad denomination: " + entry};
+    table.push_back(make_denomination(entry.substr(0, equals), static_cast<uint32_t>(value)));
+    start = comma + 1;
+  }
+  if (table.empty())
+    throw invalid_argument {"no denominations"};
+  sort(table.begin(), table.end(), [](const Denomination &a, const Denomination &b) { return a.value > b.value; });
+  return table;
+}
+
+const size_t chunk_size {4096};
+
+// the vectorized kernel: counts[k * chunk_size + i] = how many of coin k amount i gets, balance[i] ends up as what can't be paid
+void make_change(const vector<Denomination> &table, const uint32_t *amounts, size_t count, uint32_t *counts, uint32_t *balance) {
+  for (size_t i {0}; i < count; ++i)
+    balance[i] = amounts[i];
+  for (size_t k {0}; k < table.size(); ++k) {
+    const uint64_t multiplier = table[k].multiplier;
+    const int shift = table[k].shift;
+    const uint32_t value = table[k].value;
+    uint32_t *coins = counts + k * chunk_size;
+    for (size_t i {0}; i < count; ++i) {        // no branches, no division - one SIMD loop per coin
+      uint32_t q = static_cast<uint32_t>((balance[i] * multiplier) >> shift);
+      coins[i] = q;
+      balance[i] -= q * value;
+    }
+  }
 }
-// The condition is an expression that evaluates to true or false. If the condition is true, then the statement is executed. If the condition is false, then the statement is skipped. The statement can be a single statement or a block of statements enclosed in curly braces. The if statement is often used in conjunction with the relational operators. For example
-if (score >= 60)
-  cout << "You passed the exam." << endl;
-// The if statement can be used without an else clause. In this case, the statement is executed only if the condition is true. If the condition is false, then the statement is skipped. The else clause is optional. If you want to execute a statement or a group of statements when the condition is false, then you can use the else clause as follows:
-if (score >= 60)
-  cout << "You passed the exam." << endl;
-else
-  cout << "You failed the exam." << endl;
 
-//  blocks. We've actually already seen a block statement. Remember, the main function we've been using in all our programs so far, it has an open curly at the beginning and a closed curly at the end. This is a block statement and we had sequences of statements in the block statement. Block statements introduce a new level of scope. just like we declared variables in the main block, we can declare variables in any block, even in a block that's inside an if statement. Variables that we declare in a block are only visible to statements that are also in the same block. This lets us modularize our code so we have better control of who sees what, which makes writing and debugging our code easier.
+// reads unsigned integers (one per line, or separated by any non-digit) from a file in large blocks - a - right before a number is a negative amount and an error
+class AmountReader {
+  FILE *in;
+  vector<char> block;
+  size_t used {0}, position {0};
+  bool eof {false};
+  bool minus {false};                           // the last character was a '-', maybe in the last block
+  static uint32_t checked(uint64_t value) {
+    if (value > 0x7fffffff)                     // the multiply-shift divisions are exact below 2^31
+      throw out_of_range {"amount too large: " + to_string(value)};
+    return static_cast<uint32_t>(value);
+  }
+public:
+  explicit AmountReader(FILE *in) : in{in}, block(1 << 20) {}
+  // fills up to max amounts, returns how many were read (0 at the end of the file)
+  size_t read(uint32_t *amounts, size_t max) {
+    size_t count {0};
+    uint64_t value {0};
+    int digits {0};                             // not counting leading zeros
+    bool in_number {false};
+    while (count < max) {
+      if (position == used) {
+        if (eof)
+          break;
+        used = fread(block.data(), 1, block.size(), in);
+        position = 0;
+        if (used == 0) {
+          eof = true;
+          break;
+        }
+      }
+      char c = block[position++];
+      if (c >= '0' && c <= '9') {               // a number may continue into the next block, so keep the partial value
+        if (minus)
+          throw out_of_range {"negative amounts can't be paid out"};
+        digits += value != 0 || c != '0';
+        if (digits > 10)                        // 2^31 has 10 digits - stop before value can wrap around
+          throw out_of_range {"amount too large: more than 10 digits"};
+        value = value * 10 + (c - '0');
+        in_number = true;
+      } else {
+        minus = c == '-' && !in_number;         // before a number it's a sign, right after one ("12-50") a separator
+        if (in_number) {
+          amounts[count++] = checked(value);
+          value = 0;
+          digits = 0;
+          in_number = false;
+        }
+      }
+    }
+    if (in_number)                              // last number in the file without a newline
+      amounts[count++] = checked(value);
+    return count;
+  }
+};
 
-int main() {
-  int num {};
-  const int min {10};
-  const int max {100};
-  
-  cout << "Enter a number between " << min << " and " << max << ": ";
-  cin >> num;
-  
-  if (num >= min) {
-    cout << "\n=========== If statement 1 =============" << endl;
-    cout << num << " is greater than or equal to " << min << endl;
-  
-    int diff {num - min};
-    cout << num << " is " << diff << " greater than " << min << endl;
+// collects text in a big buffer and writes it out in large pieces
+class BufferedWriter {
+  vector<char> buffer;
+  size_t used {0};
+  FILE *out;
+public:
+  explicit BufferedWriter(FILE *out, size_t capacity = 1 << 20) : buffer(capacity), out{out} {}
+  ~BufferedWriter() { flush(); }
+  void flush() {
+    fwrite(buffer.data(), 1, used, out);
+    used = 0;
   }
-  
-  if (num <= max) {
-    cout << "\n=========== If statement 2=============" << endl;
-    cout << num << " is less than or equal to " << max << endl;
-    
-    int diff { max -num};
-    cout << num << " is " << diff << " less than " << max << endl;
+  void write(uint64_t value, char separator) {
+    if (buffer.size() - used < 24)
+      flush();
+    auto result = to_chars(buffer.data() + used, buffer.data() + buffer.size(), value);
+    *result.ptr = separator;
+    used = result.ptr + 1 - buffer.data();
   }
-  
-  if (num >= min && num <=max) {
-    cout << "\n=========== If statement 3=============" << endl;   
-    cout << num << " is in range " << endl;
-    cout << " This means satements 1 and 2 must also display!!" << endl;
+  void write(const string &text) {
+    if (buffer.size() - used < text.size())
+      flush();
+    copy(text.begin(), text.end(), buffer.data() + used);   // the buffer is much larger than any header line
+    used += text.size();
   }
-  
-  if (num == min || num == max) {
-    cout << "\n=========== If statement 4 =============" << endl;   
+};
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    cerr << "usage: " << argv[0] << " <amounts file> [--totals] [--table name=value,...]" << endl;
+    return 1;
+  }
+  bool totals_only {false};
+  string table_spec {"dollars=100,quarters=25,dimes=10,nickels=5,pennies=1"};
+  for (int i {2}; i < argc; ++i) {
+    string arg {argv[i]};
+    if (arg == "--totals")
+      totals_only = true;
+    else if (arg == "--table" && i + 1 < argc)
+      table_spec = argv[++i];
+  }
+  vector<Denomination> table;
+  try {
+    table = parse_table(table_spec);
+  } catch (const exception &ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  FILE *in = fopen(argv[1], "rb");
+  if (!in) {
+    cerr << "Error opening file " << argv[1] << endl;
+    return 1;
+  }
+
+  AmountReader reader {in};
+  BufferedWriter writer {stdout};
+  vector<uint32_t> amounts(chunk_size), balance(chunk_size), counts(table.size() * chunk_size);
+  vector<uint64_t> totals(table.size());
+  uint64_t transactions {0}, left_over {0};
+
+  if (!totals_only) {                           // columnar output: amount, then one column per coin
+    string header {"amount"};
+    for (const auto &coin: table)
+      header += "\t" + coin.name;
+    writer.write(header + "\n");
+  }
+  try {
+    while (size_t count = reader.read(amounts.data(), chunk_size)) {
+      make_change(table, amounts.data(), count, counts.data(), balance.data());
+      transactions += count;
+      for (size_t k {0}; k < table.size(); ++k)
+        for (size_t i {0}; i < count; ++i)
+          totals[k] += counts[k * chunk_size + i];
+      for (size_t i {0}; i < count; ++i)
+        left_over += balance[i];                  // only non-zero when the table has no 1 cent coin
+      if (!totals_only)
+        for (size_t i {0}; i < count; ++i) {
+          writer.write(amounts[i], '\t');
+          for (size_t k {0}; k < table.size(); ++k)
+            writer.write(counts[k * chunk_size + i], k + 1 == table.size() ? '\n' : '\t');
+        }
+    }
+  } catch (const out_of_range &ex) {
+    cerr << ex.what() << endl;
+    fclose(in);
+    return 1;
+  }
+  fclose(in);
+  writer.flush();
+
+  if (totals_only) {
+    cout << "transactions : " << transactions << endl;
+    for (size_t k {0}; k < table.size(); ++k)
+      cout << table[k].name << " : " << totals[k] << endl;
+    cout << "left over    : " << left_over << endl;
+  }
+  return 0;
+}
+
+// challenge - your own currency system, greedy or not
+// "Feel free to use your own currency system." Careful: taking as many of the largest coin as fit, then the next one and so on (the greedy method used above) gives the fewest coins for US coins, but not for every currency. With coins of 1, 3 and 4, greedy pays 6 as 4 + 1 + 1, but 3 + 3 is only two coins. Currencies where greedy always works are called canonical. This program loads any set of coins and first checks whether greedy is optimal for it: if greedy ever loses, it already loses on some amount below the sum of the two largest coins (Kozen and Zaks), so we only compare greedy against the exact answer on those amounts. If greedy is fine we keep using it. If not, we fill a dynamic programming table once: the fewest coins for amount v is 1 + the fewest coins for v - c, for the best coin c. Each row of the table holds the complete answer (how many of each coin) and the rows are stored one after the other in one vector, so a query is one lookup into a contiguous row, no searching. Amounts above the table still get an exact answer: some best answer uses fewer than (largest coin) smaller coins, so everything above largest * second largest is "the best small part with the same remainder" plus largest coins, which we also precompute once per remainder. The table is capped at 1 GB: --max only sets how far plain lookups go, and a coin set whose largest * second largest coin alone needs more than that is rejected with an error instead of allocating without bound.
+// usage: change_optimizer [--table name=value,...] [--max amount] - then enter amounts in cents, one per line
+#include <iostream>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+using namespace std;
+
+struct Denomination {
+  string name;
+  uint64_t value;           // in cents
+};
+
+// parse "dollars=100,quarters=25,..." - the coins are kept largest first
+vector<Denomination> parse_table(const string &spec) {
+  vector<Denomination> table;
+  size_t start {0};
+  while (start < spec.size()) {
+    size_t comma = spec.find(',', start);
+    if (comma == string::npos)
+      comma = spec.size();
+    string entry = spec.substr(start, comma - start);
+    size_t equals = entry.find('=');
+    if (equals == string::npos || stoull(entry.substr(equals + 1)) == 0)
+      throw invalid_argument {"bad denomination: " + entry};
+    table.push_back({entry.substr(0, equals), stoull(entry.substr(equals + 1))});
+    start = comma + 1;
+  }
+  if (table.empty())
+    throw invalid_argument {"no denominations"};
+  sort(table.begin(), table.end(), [](const Denomination &a, const Denomination &b) { return a.value > b.value; });
+  return table;
+}
+
+class ChangeEngine {
+  static constexpr uint32_t impossible {UINT32_MAX};
+  static constexpr uint64_t max_table_entries {1 << 28};    // 1 GB of uint32_t - coin sets that need more are rejected
+  vector<Denomination> coins;
+  bool greedy {true};
+  uint64_t table_max {0};
+  vector<uint32_t> rows;            // row v: total coins, then the count of every coin - (table_max + 1) rows
+  vector<uint64_t> residue_best;    // for amounts above the table: the best small part for every remainder mod the largest coin
+
+  size_t row_size() const { return coins.size() + 1; }
+  const uint32_t *row(uint64_t amount) const { return rows.data() + amount * row_size(); }
+
+  // fewest coins for every amount in [0, limit] - returns a vector with impossible where no change is possible
+  vector<uint32_t> fewest_coins(uint64_t limit) const {
+    vector<uint32_t> fewest(limit + 1, impossible);
+    fewest[0] = 0;
+    for (uint64_t v {1}; v <= limit; ++v)
+      for (const auto &coin: coins)
+        if (coin.value <= v && fewest[v - coin.value] != impossible && fewest[v - coin.value] + 1 < fewest[v])
+          fewest[v] = fewest[v - coin.value] + 1;
+    return fewest;
+  }
+  bool greedy_change(uint64_t amount, vector<uint64_t> &counts) const {
+    for (size_t k {0}; k < coins.size(); ++k) {
+      counts[k] = amount / coins[k].value;
+      amount %= coins[k].value;
+    }
+    return amount == 0;
+  }
+  bool greedy_is_optimal() const {
+    if (coins.size() < 3)           // one or two coins (with a 1 among them) are always canonical
+      return coins.back().value == 1;
+    if (coins.back().value != 1)    // without a 1 cent coin greedy can miss an answer that exists
+      return false;
+    if (coins[0].value > max_table_entries / 2)
+      throw invalid_argument {"the coins are too large to check: " + coins[0].name + " + " + coins[1].name + " is above " + to_string(max_table_entries)};
+    uint64_t limit = coins[0].value + coins[1].value;
+    vector<uint32_t> fewest = fewest_coins(limit);
+    vector<uint64_t> counts(coins.size());
+    for (uint64_t amount {1}; amount < limit; ++amount) {
+      greedy_change(amount, counts);
+      uint64_t used {0};
+      for (auto count: counts)
+        used += count;
+      if (used != fewest[amount])
+        return false;
+    }
+    return true;
+  }
+  void build_table(uint64_t max_amount) {
+    const uint64_t largest = coins[0].value;
+    const uint64_t second = coins.size() > 1 ? coins[1].value : 1;
+    const uint64_t max_rows = max_table_entries / row_size() - 1;
+    if (largest > max_rows / second)  // the table must cover every "small part" for the remainder trick
+      throw invalid_argument {"the coins are too large for the change table: " + coins[0].name + (coins.size() > 1 ? " * " + coins[1].name : string {}) + " needs more than " + to_string(max_table_entries) + " entries"};
+    table_max = max(min(max_amount, max_rows), largest * second);   // above max_amount the remainder trick is still exact, just not one lookup
+    rows.assign((table_max + 1) * row_size(), 0);
+    rows[0] = 0;
+    for (uint64_t v {1}; v <= table_max; ++v) {
+      uint32_t *current = rows.data() + v * row_size();
+      current[0] = impossible;
+      size_t best_coin {0};
+      for (size_t k {0}; k < coins.size(); ++k)
+        if (coins[k].value <= v) {
+          uint32_t previous = row(v - coins[k].value)[0];
+          if (previous != impossible && previous + 1 < current[0]) {
+            current[0] = previous + 1;
+            best_coin = k;
+          }
+        }
+      if (current[0] == impossible)
+        continue;
+      const uint32_t *from = row(v - coins[best_coin].value);   // copy the smaller answer and add one coin
+      copy(from + 1, from + row_size(), current + 1);
+      ++current[1 + best_coin];
+    }
+    // small part V with V % largest == r that minimizes coins(V) + (A - V) / largest, i.e. coins(V) * largest - V
+    residue_best.assign(largest, UINT64_MAX);
+    for (uint64_t v {0}; v < largest * second; ++v) {
+      if (row(v)[0] == impossible)
+        continue;
+      uint64_t &best = residue_best[v % largest];
+      if (best == UINT64_MAX || row(v)[0] * largest - v < row(best)[0] * largest - best)
+        best = v;
+    }
+  }
+public:
+  // throws invalid_argument for coins that would need a table larger than max_table_entries
+  ChangeEngine(vector<Denomination> coins, uint64_t max_amount) : coins{move(coins)} {
+    greedy = greedy_is_optimal();
+    if (!greedy)
+      build_table(max_amount);
+  }
+  bool uses_greedy() const { return greedy; }
+  const vector<Denomination> &denominations() const { return coins; }
+  // counts[k] = how many of coin k (largest first) - returns false if the amount can't be paid with these coins
+  bool make_change(uint64_t amount, vector<uint64_t> &counts) const {
+    counts.assign(coins.size(), 0);
+    if (greedy)
+      return greedy_change(amount, counts);
+    uint64_t extra_largest {0};
+    if (amount > table_max) {       // best small part with the same remainder, the rest in largest coins
+      uint64_t small = residue_best[amount % coins[0].value];
+      if (small == UINT64_MAX)
+        return false;
+      extra_largest = (amount - small) / coins[0].value;
+      amount = small;
+    }
+    const uint32_t *answer = row(amount);
+    if (answer[0] == impossible)
+      return false;
+    for (size_t k {0}; k < coins.size(); ++k)
+      counts[k] = answer[1 + k];
+    counts[0] += extra_largest;
+    return true;
+  }
+};
+
+int main(int argc, char *argv[]) {
+  string table_spec {"dollars=100,quarters=25,dimes=10,nickels=5,pennies=1"};
+  uint64_t max_amount {100'000};
+  for (int i {1}; i + 1 < argc; i += 2) {
+    string arg {argv[i]};
+    if (arg == "--table")
+      table_spec = argv[i + 1];
+    else if (arg == "--max")
+      max_amount = stoull(argv[i + 1]);
+  }
+  optional<ChangeEngine> engine;
+  try {
+    engine.emplace(parse_table(table_spec), max_amount);
+  } catch (const exception &ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  cout << (engine->uses_greedy() ? "Greedy change is optimal for these coins" : "Greedy change is NOT optimal for these coins - using the precomputed table") << endl;
+
+  uint64_t change_amount {};
+  vector<uint64_t> counts;
+  cout << "Enter an amount in cents : ";
+  while (cin >> change_amount) {
+    if (engine->make_change(change_amount, counts)) {
+      cout << "\nYou can provide this change as follows : " << endl;
+      for (size_t k {0}; k < counts.size(); ++k)
+        cout << engine->denominations()[k].name << " : " << counts[k] << endl;
+    } else {
+      cout << change_amount << " can't be paid with these coins" << endl;
+    }
+    cout << "\nEnter an amount in cents : ";
+  }
+  cout << endl;
+  return 0;
+}
+
+/***************************************************************************************************************************/
+
+//  control structures: that allow you to control the flow of execution in your program. So far you've learned how to write programs that run sequentially that is one statement followed by another and so forth. You can solve many problems using sequence. But now is when we really take advantage of the power of programming. we'll go over the selection and iteration control structures in c++. Selection control structures allow you to make decisions and execute parts of your program only when certain conditions are true or false. This is so powerful and opens up a world of programming power. So we have these three basic programming building blocks: sequence, selection and iteration. With sequence, selection and iteration, we can implement any algorithm, Let me repeat that: with sequence, selection and iteration, we can implement any algorithm.
+
+// if statement - The if statement is the most basic selection statement. It allows you to execute a statement or a group of statements only if a particular condition is true. The syntax of the if statement is:
+if (condition)
+  statement;
+if(num > 10) { // A block statement is a sequence of statements inside a block which is made up of opening and closing curly brackets.
+  cout << "num is greater than 10" << endl;
+  cout << "I'm in the if block" << endl;
+}
+// The condition is an expression that evaluates to true or false. If the condition is true, then the statement is executed. If the condition is false, then the statement is skipped. The statement can be a single statement or a block of statements enclosed in curly braces. The if statement is often used in conjunction with the relational operators. For example
+if (score >= 60)
+  cout << "You passed the exam." << endl;
+// The if statement can be used without an else clause. In this case, the statement is executed only if the condition is true. If the condition is false, then the statement is skipped. The else clause is optional. If you want to execute a statement or a group of statements when the condition is false, then you can use the else clause as follows:
+if (score >= 60)
+  cout << "You passed the exam." << endl;
+else
+  cout << "You failed the exam." << endl;
+
+//  blocks. We've actually already seen a block statement. Remember, the main function we've been using in all our programs so far, it has an open curly at the beginning and a closed curly at the end. This is a block statement and we had sequences of statements in the block statement. Block statements introduce a new level of scope. just like we declared variables in the main block, we can declare variables in any block, even in a block that's inside an if statement. Variables that we declare in a block are only visible to statements that are also in the same block. This lets us modularize our code so we have better control of who sees what, which makes writing and debugging our code easier.
+
+int main() {
+  int num {};
+  const int min {10};
+  const int max {100};
+  
+  cout << "Enter a number between " << min << " and " << max << ": ";
+  cin >> num;
+  
+  if (num >= min) {
+    cout << "\n=========== If statement 1 =============" << endl;
+    cout << num << " is greater than or equal to " << min << endl;
+  
+    int diff {num - min};
+    cout << num << " is " << diff << " greater than " << min << endl;
+  }
+  
+  if (num <= max) {
+    cout << "\n=========== If statement 2=============" << endl;
+    cout << num << " is less than or equal to " << max << endl;
+    
+    int diff { max -num};
+    cout << num << " is " << diff << " less than " << max << endl;
+  }
+  
+  if (num >= min && num <=max) {
+    cout << "\n=========== If statement 3=============" << endl;   
+    cout << num << " is in range " << endl;
+    cout << " This means satements 1 and 2 must also display!!" << endl;
+  }
+  
+  if (num == min || num == max) {
+    cout << "\n=========== If statement 4 =============" << endl;   
     cout << num << " is right on a boundary " << endl;
     cout << "This means all 4 statements display " << endl;
 
@@ -2558,6 +4263,385 @@ int main() {
   return 0;
 }
 
+// Shipping cost calculator - pricing a whole warehouse manifest
+// The calculator above prices one package per run. A warehouse ships millions of packages an hour, so this version reads a whole manifest, either a CSV file with length,width,height on every line or a binary file of 32-bit integers (length, width, height, length, width, height, ...). The packages are stored as a structure of arrays: one vector of lengths, one of widths, one of heights, instead of one vector of package structs. That way the pricing loop reads three plain arrays and the compiler can process 8 packages per SIMD instruction. The loop itself has no if/else: a comparison gives 0 or 1, so rejected = (length > max) | (width > max) | (height > max), and the surcharge is tier1 * (volume > tier1 threshold and not above tier2) + tier2 * (volume > tier2 threshold). The manifest is cut into one chunk per thread and every thread prices its own chunk.
+// usage: shipping_batch <manifest.csv | manifest.bin> [--binary] [--totals]
+//        shipping_batch --generate <count> <manifest.bin>   writes a random manifest to try it out
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <thread>
+#include <charconv>
+#include <chrono>
+#include <algorithm>
+using namespace std;
+
+// the same tariff as the calculator above
+const double base_cost {2.50};
+const int tier1_threshold {100};    // volume
+const int tier2_threshold {500};    // volume
+const int max_dimension_length {10};  // inches
+const double tier1_surcharge {0.10};  // 10% extra
+const double tier2_surcharge {0.25};  // 25% extra
+
+struct Manifest {                     // structure of arrays
+  vector<int32_t> length, width, height;
+  size_t size() const { return length.size(); }
+};
+
+struct PricedManifest {
+  vector<double> cost;                // 0 for rejected packages
+  vector<uint8_t> rejected;
+};
+
+bool load_binary(const string &file_name, Manifest &manifest) {
+  FILE *in = fopen(file_name.c_str(), "rb");
+  if (!in)
+    return false;
+  fseek(in, 0, SEEK_END);                 // the file size tells us the package count, so every vector is sized once
+  size_t packages = ftell(in) / (3 * sizeof(int32_t));
+  fseek(in, 0, SEEK_SET);
+  manifest.length.resize(packages);
+  manifest.width.resize(packages);
+  manifest.height.resize(packages);
+  vector<int32_t> triples(3 * 65536);
+  size_t loaded {0};
+  while (size_t read = fread(triples.data(), sizeof(int32_t), triples.size(), in) / 3) {
+    for (size_t i {0}; i < read && loaded < packages; ++i, ++loaded) {   // split the triples into the three arrays
+      manifest.length[loaded] = triples[3 * i];
+      manifest.width[loaded] = triples[3 * i + 1];
+      manifest.height[loaded] = triples[3 * i + 2];
+    }
+  }
+  fclose(in);
+  return true;
+}
+
+// every 3 numbers in the file are one package - anything that isn't a digit (commas, newlines, a header line) separates numbers
+bool load_csv(const string &file_name, Manifest &manifest) {
+  FILE *in = fopen(file_name.c_str(), "rb");
+  if (!in)
+    return false;
+  vector<char> block(1 << 20);
+  int32_t value {0}, fields[3];
+  int field {0};
+  bool in_number {false};
+  auto end_number = [&]() {
+    fields[field++] = value;
+    if (field == 3) {
+      manifest.length.push_back(fields[0]);
+      manifest.width.push_back(fields[1]);
+      manifest.height.push_back(fields[2]);
+      field = 0;
+    }
+    value = 0;
+    in_number = false;
+  };
+  while (size_t used = fread(block.data(), 1, block.size(), in)) {
+    for (size_t i {0}; i < used; ++i) {
+      char c = block[i];
+      if (c >= '0' && c <= '9') {
+        value = value < INT32_MAX / 10 ? value * 10 + (c - '0') : INT32_MAX;   // a run of digits too long for int32 stays at INT32_MAX, which is rejected anyway
+        in_number = true;
+      } else if (in_number) {
+        end_number();
+      }
+    }
+  }
+  if (in_number)
+    end_number();
+  fclose(in);
+  return true;
+}
+
+// prices packages [first, last) - no branches in the loop, so it vectorizes (-O3 -march=native)
+void price_packages(const Manifest &manifest, PricedManifest &priced, size_t first, size_t last) {
+  const int32_t *length = manifest.length.data();
+  const int32_t *width = manifest.width.data();
+  const int32_t *height = manifest.height.data();
+  double *cost = priced.cost.data();
+  uint8_t *rejected = priced.rejected.data();
+  for (size_t i {first}; i < last; ++i) {
+    int32_t reject = (length[i] > max_dimension_length) | (width[i] > max_dimension_length) | (height[i] > max_dimension_length);
+    // every dimension clamped to +-(max_dimension_length + 1) first: that doesn't change the volume of a package we accept, and the product can't overflow
+    const int64_t bound {max_dimension_length + 1};
+    int64_t package_volume = min(max<int64_t>(length[i], -bound), bound) * min(max<int64_t>(width[i], -bound), bound) * min(max<int64_t>(height[i], -bound), bound);
+    int32_t tier2 = package_volume > tier2_threshold;
+    int32_t tier1 = (package_volume > tier1_threshold) & !tier2;
+    double surcharge = tier1 * tier1_surcharge + tier2 * tier2_surcharge;
+    cost[i] = (1 - reject) * (base_cost + base_cost * surcharge);
+    rejected[i] = static_cast<uint8_t>(reject);
+  }
+}
+
+void generate(size_t count, const string &file_name) {
+  FILE *out = fopen(file_name.c_str(), "wb");
+  if (!out) {
+    cerr << "Error creating file " << file_name << endl;
+    return;
+  }
+  uint64_t state {12345};
+  vector<int32_t> triples;
+  for (size_t i {0}; i < count; ++i) {
+    for (int d {0}; d < 3; ++d) {
+      state = state * 6364136223846793005ULL + 1442695040888963407ULL;   // a simple LCG is plenty for test data
+      triples.push_back(1 + static_cast<int32_t>((state >> 33) % 12)); // 1..12 inches, so some get rejected
+    }
+    if (triples.size() >= 3 * 65536) {
+      fwrite(triples.data(), sizeof(int32_t), triples.size(), out);
+      triples.clear();
+    }
+  }
+  fwrite(triples.data(), sizeof(int32_t), triples.size(), out);
+  fclose(out);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc == 4 && string {argv[1]} == "--generate") {
+    generate(stoull(argv[2]), argv[3]);
+    return 0;
+  }
+  if (argc < 2) {
+    cerr << "usage: " << argv[0] << " <manifest.csv | manifest.bin> [--binary] [--totals]" << endl;
+    return 1;
+  }
+  string file_name {argv[1]};
+  bool binary = file_name.size() > 4 && file_name.substr(file_name.size() - 4) == ".bin";
+  bool totals_only {false};
+  for (int i {2}; i < argc; ++i) {
+    string arg {argv[i]};
+    if (arg == "--binary")
+      binary = true;
+    else if (arg == "--totals")
+      totals_only = true;
+  }
+
+  auto start = chrono::steady_clock::now();
+  Manifest manifest;
+  if (!(binary ? load_binary(file_name, manifest) : load_csv(file_name, manifest))) {
+    cerr << "Error opening file " << file_name << endl;
+    return 1;
+  }
+  auto loaded = chrono::steady_clock::now();
+
+  PricedManifest priced;
+  priced.cost.resize(manifest.size());
+  priced.rejected.resize(manifest.size());
+  unsigned threads = thread::hardware_concurrency();
+  if (threads == 0)
+    threads = 1;
+  vector<thread> workers;
+  for (unsigned t {0}; t < threads; ++t)
+    workers.emplace_back(price_packages, cref(manifest), ref(priced), manifest.size() * t / threads, manifest.size() * (t + 1) / threads);
+  for (auto &worker: workers)
+    worker.join();
+  auto priced_at = chrono::steady_clock::now();
+
+  if (totals_only) {
+    double total_cost {0};
+    size_t total_rejected {0};
+    for (size_t i {0}; i < manifest.size(); ++i) {
+      total_cost += priced.cost[i];
+      total_rejected += priced.rejected[i];
+    }
+    cout << fixed << setprecision(2);
+    cout << "packages : " << manifest.size() << endl;
+    cout << "rejected : " << total_rejected << endl;
+    cout << "shipping : $" << total_cost << endl;
+    cout << "load " << chrono::duration<double>(loaded - start).count() << " s, price "
+         << chrono::duration<double>(priced_at - loaded).count() << " s on " << threads << " thread(s)" << endl;
+  } else {
+    vector<char> buffer(1 << 20);                 // one line per package, formatted with to_chars into a big buffer
+    size_t used {0};
+    for (size_t i {0}; i < manifest.size(); ++i) {
+      if (buffer.size() - used < 32) {
+        fwrite(buffer.data(), 1, used, stdout);
+        used = 0;
+      }
+      char *p = buffer.data() + used;
+      if (priced.rejected[i]) {
+        const char rejected_text[] {"rejected\n"};
+        p = copy(rejected_text, rejected_text + sizeof(rejected_text) - 1, p);
+      } else {
+        p = to_chars(p, buffer.data() + buffer.size(), priced.cost[i], chars_format::fixed, 2).ptr;
+        *p++ = '\n';
+      }
+      used = p - buffer.data();
+    }
+    fwrite(buffer.data(), 1, used, stdout);
+  }
+  return 0;
+}
+
+// Shipping cost calculator - tariff tables from a config file, reloaded while running
+// In the calculator the prices are local constants in main, so a new price means a recompile, and a new tier means another else if. Here the whole tariff lives in a text file with any number of tiers:
+//   base_cost 2.50
+//   max_dimension_length 10
+//   tier 100 0.10      <- volume threshold and surcharge, a package pays the surcharge of the highest threshold its volume is above
+//   tier 500 0.25
+// The thresholds are kept sorted, so finding the tier is a search. We use a branchless binary search: every step moves the base pointer with a conditional move instead of an if, so the CPU never mispredicts a branch, and the number of steps only depends on the number of tiers. The service keeps the current tariff behind an atomic shared_ptr. A pricing request loads the pointer once and uses that snapshot from start to end. When the file changes, a watcher thread builds a complete new Tariff on the side and swaps the pointer in one atomic store (read-copy-update): requests that already hold the old tariff finish with it, new requests see the new one, and the old tariff is deleted when its last user lets go of it. A request never waits for the reload to read or parse the file; the atomic load and store themselves are only lock-free where the library makes them so (libstdc++ guards atomic<shared_ptr> with a small internal lock held for a few instructions). A file with a mistake in it is reported and ignored, the old tariff stays. Save a new tariff by writing a temporary file and renaming it over the old one (mv, or what most editors do), so the watcher only ever sees complete files. As a guard against editing in place, the watcher also waits until the file stops changing for one poll, and on a reload a file that is empty or doesn't end with a newline counts as still being written (at startup it's accepted as it is).
+// usage: shipping_service <tariff file> - then enter length width height, one package per line (compile with -std=c++20)
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <filesystem>
+#include <algorithm>
+#include <stdexcept>
+using namespace std;
+
+struct Tariff {
+  double base_cost {2.50};
+  int max_dimension_length {10};      // inches, at most 2000000 so that a volume always fits in int64_t
+  vector<int64_t> thresholds;         // volumes, sorted ascending
+  vector<double> surcharges;          // surcharges[k] = surcharge above k thresholds - surcharges[0] is 0
+
+  // number of thresholds the volume is above - branchless binary search over the sorted thresholds
+  size_t tier(int64_t package_volume) const {
+    if (thresholds.empty())
+      return 0;
+    const int64_t *base = thresholds.data();
+    size_t n = thresholds.size();
+    while (n > 1) {
+      size_t half = n / 2;
+      base = (base[half - 1] < package_volume) ? base + half : base;   // compiles to a conditional move
+      n -= half;
+    }
+    return (base - thresholds.data()) + (*base < package_volume);
+  }
+  // only for dimensions price() accepts, 1 .. max_dimension_length
+  static int64_t volume(int length, int width, int height) { return static_cast<int64_t>(length) * width * height; }
+  // negative cost means rejected
+  double price(int length, int width, int height) const {
+    if (length > max_dimension_length || width > max_dimension_length || height > max_dimension_length || length < 1 || width < 1 || height < 1)
+      return -1;
+    return base_cost + base_cost * surcharges[tier(volume(length, width, height))];
+  }
+};
+
+// reloading: a file that is empty or doesn't end with a newline is taken to be still being written and refused
+shared_ptr<const Tariff> load_tariff(const string &file_name, bool reloading = false) {
+  ifstream in_file {file_name};
+  if (!in_file)
+    throw runtime_error {"can't open " + file_name};
+  auto tariff = make_shared<Tariff>();
+  vector<pair<int64_t, double>> tiers;
+  string line;
+  int line_number {0};
+  while (getline(in_file, line)) {
+    ++line_number;
+    istringstream iss {line};
+    string key;
+    if (!(iss >> key) || key[0] == '#')
+      continue;
+    bool ok {false};
+    if (key == "base_cost") {
+      ok = static_cast<bool>(iss >> tariff->base_cost);
+    } else if (key == "max_dimension_length") {
+      ok = iss >> tariff->max_dimension_length && tariff->max_dimension_length >= 1 && tariff->max_dimension_length <= 2'000'000;
+    } else if (key == "tier") {
+      int64_t threshold {};
+      double surcharge {};
+      ok = static_cast<bool>(iss >> threshold >> surcharge);
+      tiers.push_back({threshold, surcharge});
+    }
+    if (!ok)
+      throw runtime_error {file_name + " line " + to_string(line_number) + ": can't read \"" + line + "\""};
+  }
+  sort(tiers.begin(), tiers.end());
+  tariff->surcharges.push_back(0.0);
+  for (const auto &[threshold, surcharge]: tiers) {
+    tariff->thresholds.push_back(threshold);
+    tariff->surcharges.push_back(surcharge);
+  }
+  if (!reloading)
+    return tariff;                    // a hand-written file without a newline at the end is fine at startup
+  in_file.clear();                    // a file that is still being written is usually cut off in the middle of a line
+  in_file.seekg(0, ios::end);
+  if (in_file.tellg() <= 0)
+    throw runtime_error {file_name + " is empty"};
+  in_file.seekg(-1, ios::end);
+  if (in_file.get() != '\n')
+    throw runtime_error {file_name + " doesn't end with a newline - is it still being written?"};
+  return tariff;
+}
+
+class TariffService {
+  atomic<shared_ptr<const Tariff>> current;
+  string file_name;
+  atomic<bool> running {true};
+  thread watcher;
+  void watch() {
+    error_code ec;                    // never the throwing overloads here - an exception on this thread ends the program
+    auto loaded = filesystem::last_write_time(file_name, ec);
+    auto seen = loaded;
+    while (running) {
+      this_thread::sleep_for(chrono::milliseconds(500));
+      auto write_time = filesystem::last_write_time(file_name, ec);
+      if (ec || write_time == loaded)
+        continue;
+      if (write_time != seen) {       // still changing - wait until it stays the same for a whole poll
+        seen = write_time;
+        continue;
+      }
+      loaded = write_time;
+      try {
+        current.store(load_tariff(file_name, true));  // the swap - readers never see a half built tariff
+        cerr << "[tariff reloaded from " << file_name << "]" << endl;
+      } catch (const exception &ex) {
+        cerr << "[tariff not reloaded - " << ex.what() << "]" << endl;
+      }
+    }
+  }
+public:
+  explicit TariffService(const string &file_name) : current{load_tariff(file_name)}, file_name{file_name} {
+    watcher = thread {&TariffService::watch, this};
+  }
+  ~TariffService() {
+    running = false;
+    watcher.join();
+  }
+  // a snapshot: stays valid and unchanged for as long as the caller holds it, even across a reload
+  shared_ptr<const Tariff> snapshot() const { return current.load(); }
+};
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    cerr << "usage: " << argv[0] << " <tariff file>" << endl;
+    return 1;
+  }
+  try {
+    TariffService service {argv[1]};
+    int length{}, width{}, height{};
+    cout << fixed << setprecision(2); // prints dollars nicely
+    cout << "Welcome to the package cost service" << endl;
+    cout << "Enter length, width, and height of the package separated by spaces : ";
+    while (cin >> length >> width >> height) {
+      shared_ptr<const Tariff> tariff = service.snapshot();   // one tariff for the whole request
+      double package_cost = tariff->price(length, width, height);
+      if (package_cost < 0)
+        cout << "Sorry, package rejected - dimension exceeded" << endl;
+      else
+        cout << "Your package (tier " << tariff->tier(Tariff::volume(length, width, height)) << ") will cost $" << package_cost << " to ship " << endl;
+      cout << "Enter length, width, and height of the package separated by spaces : ";
+    }
+  } catch (const exception &ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+  cout << endl;
+  return 0;
+}
+
 // switch statement - The switch statement is another way to make decisions in your code. The syntax of the switch statement is:
 switch (control_expression) { // This control expression must evaluate to an integral type or an enumeration type.
   case constant-expression1:
@@ -3136,6 +5220,153 @@ int main() {
   cout << endl;
   return 0;
 }
+
+// Nested Loops - Multiplication Table, any size, as fast as the output can take it
+// The table above is 10 x 10 and every line ends with endl, which flushes the output every time. This version builds an N x M table (up to 100,000 x 100,000, that's 10 billion lines) and doubles as an I/O throughput benchmark. The text is formatted with to_chars straight into large buffers, and only full buffers are written. The rows are cut into batches and the worker threads format different batches at the same time, while the main thread writes the finished batches strictly in order, so the output is exactly the same as the one-thread version. Each batch goes into one of a few slots; a worker waits until its slot has been written before reusing it, so the memory use stays fixed however large the table is. --binary writes only the products, as 4-byte integers (8 bytes if N * M doesn't fit in 32 bits), row after row. At the end it reports the bytes written per second.
+// usage: multiplication_table <N> <M> [--binary] [--out file]
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+using namespace std;
+
+struct TableSpec {
+  uint64_t rows, cols;
+  bool binary;
+  int width;                            // bytes per product in binary mode
+};
+
+// formats rows [first, last) at the end of buffer
+void format_rows(const TableSpec &spec, uint64_t first, uint64_t last, vector<char> &buffer) {
+  buffer.clear();
+  if (spec.binary) {
+    buffer.resize((last - first) * spec.cols * spec.width);
+    char *p = buffer.data();
+    for (uint64_t num1 {first + 1}; num1 <= last; ++num1)
+      for (uint64_t num2 {1}; num2 <= spec.cols; ++num2) {
+        uint64_t product = num1 * num2;
+        memcpy(p, &product, spec.width);    // little-endian: the low bytes come first
+        p += spec.width;
+      }
+    return;
+  }
+  const char separator[] {"-----------\n"};
+  for (uint64_t num1 {first + 1}; num1 <= last; ++num1) {
+    char prefix[32];                    // "num1 * " is the same for the whole row
+    char *prefix_end = to_chars(prefix, prefix + sizeof(prefix), num1).ptr;
+    prefix_end = copy(" * ", " * " + 3, prefix_end);
+    size_t prefix_size = prefix_end - prefix;
+    size_t start = buffer.size();
+    buffer.resize(start + spec.cols * (prefix_size + 48) + sizeof(separator));  // room for the longest lines
+    char *p = buffer.data() + start;
+    char *end = buffer.data() + buffer.size();
+    for (uint64_t num2 {1}; num2 <= spec.cols; ++num2) {
+      p = copy(prefix, prefix_end, p);
+      p = to_chars(p, end, num2).ptr;
+      p = copy(" = ", " = " + 3, p);
+      p = to_chars(p, end, num1 * num2).ptr;
+      *p++ = '\n';
+    }
+    p = copy(separator, separator + sizeof(separator) - 1, p);
+    buffer.resize(p - buffer.data());
+  }
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    cerr << "usage: " << argv[0] << " <N> <M> [--binary] [--out file]" << endl;
+    return 1;
+  }
+  TableSpec spec {stoull(argv[1]), stoull(argv[2]), false, 4};
+  string out_name;
+  for (int i {3}; i < argc; ++i) {
+    string arg {argv[i]};
+    if (arg == "--binary")
+      spec.binary = true;
+    else if (arg == "--out" && i + 1 < argc)
+      out_name = argv[++i];
+  }
+  if (spec.rows * spec.cols > UINT32_MAX)
+    spec.width = 8;
+  FILE *out = out_name.empty() ? stdout : fopen(out_name.c_str(), "wb");
+  if (!out) {
+    cerr << "Error creating file " << out_name << endl;
+    return 1;
+  }
+
+  // about 4 MB of output per batch
+  const uint64_t bytes_per_row = spec.binary ? spec.cols * spec.width : spec.cols * 30 + 12;
+  const uint64_t rows_per_batch = max<uint64_t>(1, (4 << 20) / max<uint64_t>(1, bytes_per_row));
+  const uint64_t batches = (spec.rows + rows_per_batch - 1) / rows_per_batch;
+  unsigned threads = thread::hardware_concurrency();
+  if (threads == 0)
+    threads = 1;
+  const size_t slot_count = 2 * threads;
+
+  struct Slot {
+    vector<char> buffer;
+    uint64_t batch {UINT64_MAX};        // the batch the buffer holds, once it is ready
+  };
+  vector<Slot> slots(slot_count);
+  mutex m;
+  condition_variable ready, written;
+  uint64_t next_to_write {0};
+  atomic<uint64_t> next_batch {0};
+
+  auto start = chrono::steady_clock::now();
+  vector<thread> workers;
+  for (unsigned t {0}; t < threads; ++t)
+    workers.emplace_back([&]() {
+      vector<char> buffer;
+      for (uint64_t batch = next_batch++; batch < batches; batch = next_batch++) {
+        uint64_t first = batch * rows_per_batch;
+        format_rows(spec, first, min(spec.rows, first + rows_per_batch), buffer);
+        Slot &slot = slots[batch % slot_count];
+        unique_lock<mutex> lock {m};
+        written.wait(lock, [&]() { return next_to_write + slot_count > batch; });  // the slot's previous batch is out
+        slot.buffer.swap(buffer);
+        slot.batch = batch;
+        ready.notify_all();
+      }
+    });
+
+  uint64_t bytes {0};
+  for (uint64_t batch {0}; batch < batches; ++batch) {    // the main thread writes the batches in order
+    Slot &slot = slots[batch % slot_count];
+    vector<char> buffer;
+    {
+      unique_lock<mutex> lock {m};
+      ready.wait(lock, [&]() { return slot.batch == batch; });
+      buffer.swap(slot.buffer);
+    }
+    fwrite(buffer.data(), 1, buffer.size(), out);
+    bytes += buffer.size();
+    {
+      lock_guard<mutex> lock {m};
+      ++next_to_write;
+      slot.buffer.swap(buffer);         // hand the memory back so the slot doesn't allocate again
+    }
+    written.notify_all();
+  }
+  for (auto &worker: workers)
+    worker.join();
+  fflush(out);
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  if (out != stdout)
+    fclose(out);
+
+  cerr << fixed << setprecision(2) << bytes / 1e6 << " MB in " << seconds << " s - " << bytes / seconds / 1e6 << " MB/s on " << threads << " thread(s)" << endl;
+  return 0;
+}
 // Nested Loops - Histogram
 #include <iostream>
 #include <vector>
@@ -3500,50 +5731,564 @@ int main()
   return 0;
 }
 
-/*
-Using C-style Strings
-In this exercise you will create a program that determines the length of a first name and last name individually and then the length of the entire name through the use of the C-style string functions strlen, strcpy, and strcat.
-Begin by declaring and initializing the C-style string variable first_name to contain "Bjarne".
-Now, declare and initialize a second C-style string variable last_name to contain "Stroustrup".
-You must also declare a third C-style string variable whole_name but do not initialize it yet. Remember that the variable whole_name must be large enough to contain the first and last name with no whitespaces.
-Now, by using the C-style string function strlen, declare and initialize the variable first_name_length to contain the length of the first_name string and the variable last_name_length to contain the length of the last_name string.
-Using the C-style string function strcpy, copy the first_name string into the whole_name string variable.
-Now, by using the C-style string function strcat, concatenate the last_name string at the end of the whole_name string.
-Finally, by using the C-style string function strlen, declare and initialize the variable whole_name_length to contain the length of the whole_name string.
-*/
-char first_name [7] {"Bjarne"};
-char last_name [11] {"Stroustrup"};
-char whole_name [17];
+// fixed_string - a C-style string that knows its length and can't overflow
+// The program above has two problems. Every strlen and every strcat starts at the first character and walks until it finds the \0, so building a name piece by piece scans the same characters again and again. And nothing stops cin >> first_name or strcat from writing past the end of the 20 or 50 characters, which overwrites whatever lives next to the array in memory. fixed_string<N> keeps the characters in an array inside the object, just like char[N + 1], so it never touches the heap, but it also remembers its length. size() is a simple read, append writes straight at the end, and every write is checked against the capacity N. What happens when something doesn't fit is a template parameter: Overflow::truncate keeps as much as fits (append returns false so you can tell), Overflow::error throws length_error. It converts to string_view for free, so it works with anything that takes a string_view, and c_str() is always \0 terminated for the C functions. The main below counts calls to operator new to show that assembling a name allocates nothing.
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <new>
+using namespace std;
 
-int first_name_length = strlen(first_name);
-int last_name_length = strlen(last_name);
+enum class Overflow {truncate, error};
+
+template <size_t N, Overflow policy = Overflow::truncate>
+class fixed_string {
+  size_t length {0};
+  char chars[N + 1] {};                 // + 1 for the \0
+public:
+  fixed_string() = default;
+  fixed_string(string_view text) { append(text); }
+  fixed_string(const char *text) { append(string_view {text}); }
+
+  size_t size() const { return length; }
+  static constexpr size_t capacity() { return N; }
+  bool empty() const { return length == 0; }
+  const char *c_str() const { return chars; }
+  operator string_view() const { return {chars, length}; }
+  char &operator[](size_t i) { return chars[i]; }
+  char operator[](size_t i) const { return chars[i]; }
+  char *begin() { return chars; }
+  char *end() { return chars + length; }
+  const char *begin() const { return chars; }
+  const char *end() const { return chars + length; }
+
+  // true if everything fit - with Overflow::truncate the rest is dropped, with Overflow::error nothing is appended and length_error is thrown
+  bool append(string_view text) {
+    size_t room = N - length;
+    size_t count = text.size();
+    if (count > room) {
+      if constexpr (policy == Overflow::error)
+        throw length_error {"fixed_string<" + to_string(N) + "> can't hold " + to_string(length + count) + " characters"};
+      count = room;
+    }
+    memcpy(chars + length, text.data(), count);
+    length += count;
+    chars[length] = '\0';
+    return count == text.size();
+  }
+  bool append(char c) { return append(string_view {&c, 1}); }
+  fixed_string &operator+=(string_view text) { append(text); return *this; }
+  fixed_string &operator+=(char c) { append(c); return *this; }
+  void clear() {
+    length = 0;
+    chars[0] = '\0';
+  }
+};
 
-strcpy(whole_name,first_name);
-strcat(whole_name,last_name);
+template <size_t N, Overflow policy>
+ostream &operator<<(ostream &os, const fixed_string<N, policy> &s) {
+  return os.write(s.c_str(), s.size());
+}
 
-int whole_name_length = strlen(whole_name);
+// reads one word like cin >> char_array, but stores at most the capacity - with Overflow::truncate the rest of the word is skipped
+template <size_t N, Overflow policy>
+istream &operator>>(istream &is, fixed_string<N, policy> &s) {
+  if (!(is >> ws))
+    return is;
+  s.clear();
+  for (int c = is.peek(); c != char_traits<char>::eof() && !isspace(c); c = is.peek())
+    s.append(static_cast<char>(is.get()));
+  return is;
+}
 
-// c++ string : Standard string is a class in the c++ standard template library or stl. We could do an entire course on just the scl, and that course would be very long and complex. So in this video, I'll only talk about the major elements of the c++ string class. In order to use c++ plus strings, you must include the string header file. Strings are in the standard namespace. So in order to use them without using namespace standard, you must prefix them with standard and the scope resolution operator. This is also true for the standard string methods that work with c++ strings. Like c-style strings, c++ strings are stored contiguously in memory. However, unlike c-style strings which are fixed in size, c++ strings are dynamic and can grow and shrink as needed at runtime. C++ strings work with the stream insertion and extraction operators just like most other types in c++. The c++ string class provides a rich set of methods or functions that allow us to manipulate strings easily. Chances are that if you need to do something with the string that functionality is already there for you without having to rewrite it from scratch. C++ strings also work with most of the operators that we're used to for assigning, comparing and so forth. This is a huge advantage over c-style strings since c-style strings don't work well with those operators. Even though c++ strings are preferred in most cases sometimes you need to use c-style strings. Maybe you're interfacing with a library that's been optimized for c-style strings. Well, in this use case, you can still use c++ strings and take advantage of them. And when you need to you can easily convert the c++ string into a c-style string and back again. Like vectors, c++ strings are safer since they provide methods that can bounce check and allow you to find errors in your code so you can fix them before your program goes into production.
+template <size_t N, size_t M, Overflow P, Overflow Q>
+bool operator==(const fixed_string<N, P> &a, const fixed_string<M, Q> &b) {
+  return string_view {a} == string_view {b};
+}
 
-// c++ string declaration and initialization
-#include <string>
-string s1; // empty string - Unlike c-style strings, c++ strings are always initialized. In this case, S1 is initialized to an empty string. No garbage and memory to have to worry about.
-string s2 {"Frank"}; // Frank - Notice that frank is a c-style literal, that's okay. It will be converted to a c++ string.
-string s3 {s2}; // Frank - S3 is initialized from S2, so a copy of S2 is created. S2 and S3 will both be Frank, but different Franks in different areas of memory.
-string s4 {"Frank", 3}; // Fra - declaring and initializing S4 from Frank. But I'm only using the first three characters of the string Frank.
-string s5 {s3, 0, 2}; // Fr - initializing S5 from S3 which is Frank. notice the 2 integers that follow the S3 and the initializer. The first integer is the starting index and the second is the length.
-string s6 (10, 'X'); // XXXXXXXXXX - we can initialize the string to a specific number of a specific character. Note that this uses constructor syntax with the parentheses instead of the curlies.
+// counts heap allocations so we can see there aren't any
+size_t allocation_count {0};
+void *operator new(size_t size) {
+  ++allocation_count;
+  if (void *p = malloc(size))
+    return p;
+  throw bad_alloc {};
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
 
-// c++ string assignment
-string s1;
-s1 = "Frank";
-string s2 {"amr"};
-s2 = s1; // s2 is now Frank
+int main() {
+  fixed_string<20> first_name;
+  fixed_string<20> last_name;
 
-// c++ string concatenation
-string part1 {"Frank"};
-string part2 {" amr"};
-string full_name;
+  cout << "Please enter your first name: ";
+  cin >> first_name;                    // a 30 letter name is cut at 20, nothing is overwritten
+  cout << "Please enter your last name: ";
+  cin >> last_name;
+  cout << "-------------------------------" << endl;
+
+  size_t allocations_before = allocation_count;
+  fixed_string<50> full_name {first_name};
+  full_name += ' ';
+  full_name += last_name;               // writes right after the last character, no rescan
+  size_t allocations = allocation_count - allocations_before;
+
+  cout << "Hello, " << first_name << " your first name has " << first_name.size() << " characters" << endl;
+  cout << "and your last name, " << last_name << " has " << last_name.size() << " characters" << endl;
+  cout << "Your full name is " << full_name << " (" << full_name.size() << " characters, " << allocations << " heap allocations)" << endl;
+  cout << "strlen still works on it: " << strlen(full_name.c_str()) << endl;
+
+  fixed_string<5> short_buffer {"Frank"};
+  bool fit = short_buffer.append(" Mitropoulos");
+  cout << "\ntruncate: \"" << short_buffer << "\" - everything fit: " << boolalpha << fit << endl;
+  try {
+    fixed_string<5, Overflow::error> strict {"Frank"};
+    strict += " Mitropoulos";
+  } catch (const length_error &ex) {
+    cout << "error: " << ex.what() << endl;
+  }
+
+  cout << endl;
+  return 0;
+}
+
+// C-style strings - SIMD string primitives
+// strlen, strcmp, toupper and friends look at one character at a time. A modern CPU can compare 16 (SSE2) or 32 (AVX2) characters in a single instruction: load a block of the string into a vector register, compare every byte against \0 (or the character we're looking for) at once, and turn the result into a bitmask with one bit per byte. If the mask is 0 none of them matched and we move on to the next block; otherwise the position of the lowest set bit (countr_zero) is the answer. The same idea gives the functions below:
+//   str_length     - like strlen. A block is only loaded when it can't cross into the next 4 KB memory page (otherwise the loads are aligned to the block size, which never crosses one), so it may read a few bytes past the \0, but never from a page we aren't allowed to touch (this is how the C library does it too, but AddressSanitizer will complain)
+//   find_byte      - like memchr, the position of c in the first n characters or npos
+//   find           - like string_view::find. For every position in the block we compare the first and the last character of the needle at once, and only the few positions where both match are checked with memcmp. That's very fast for normal text; worst case inputs (aaaa...ab in aaaa...a) fall back to O(n * m) like a naive search
+//   to_upper/to_lower - ASCII case mapping in place, 'a'..'z' found with one compare per block and flipped with the 0x20 bit
+//   icompare       - like strcasecmp on two string_views, <0, 0 or >0
+// Compile with -std=c++20 (for countr_zero) and -O2 -march=native to get AVX2, plain -O2 on x86-64 still gets SSE2, and anything else (or -DNO_SIMD) uses the scalar versions, which are also used for the last few characters. Run it with --test to compare every function with the C library on millions of random strings, and with --benchmark to time short (< 32 characters) and long (several MB) strings against the library. Don't expect miracles everywhere: glibc's strlen, memchr and find already use SIMD internally, so those mostly come out even; the big wins are the loops that were one character at a time, like toupper (20-30x), and short strings where our version is inlined into the caller.
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <bit>
+#include <strings.h>                      // strcasecmp, only for the test
+#if !defined(NO_SIMD) && (defined(__AVX2__) || defined(__SSE2__))
+#include <immintrin.h>
+#define HAVE_SIMD 1
+#endif
+using namespace std;
+
+constexpr size_t npos = string_view::npos;
+
+constexpr char ascii_lower(char c) { return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c; }
+constexpr char ascii_upper(char c) { return (c >= 'a' && c <= 'z') ? c - ('a' - 'A') : c; }
+
+// the scalar versions - the fallback, and the reference for the last partial block
+size_t scalar_length(const char *s) {
+  const char *p = s;
+  while (*p)
+    ++p;
+  return p - s;
+}
+
+size_t scalar_find_byte(const char *s, size_t n, char c) {
+  for (size_t i {0}; i < n; ++i)
+    if (s[i] == c)
+      return i;
+  return npos;
+}
+
+void scalar_to_upper(char *s, size_t n) {
+  for (size_t i {0}; i < n; ++i)
+    s[i] = ascii_upper(s[i]);
+}
+
+void scalar_to_lower(char *s, size_t n) {
+  for (size_t i {0}; i < n; ++i)
+    s[i] = ascii_lower(s[i]);
+}
+
+int scalar_icompare(string_view a, string_view b) {
+  size_t n = min(a.size(), b.size());
+  for (size_t i {0}; i < n; ++i) {
+    unsigned char x = ascii_lower(a[i]), y = ascii_lower(b[i]);
+    if (x != y)
+      return x < y ? -1 : 1;
+  }
+  return a.size() < b.size() ? -1 : a.size() > b.size() ? 1 : 0;
+}
+
+#ifdef HAVE_SIMD
+// the few vector operations we need, for one register width
+#ifdef __AVX2__
+using Block = __m256i;
+constexpr size_t block_size {32};
+inline Block load(const char *p) { return _mm256_loadu_si256(reinterpret_cast<const Block *>(p)); }
+inline Block load_aligned(const char *p) { return _mm256_load_si256(reinterpret_cast<const Block *>(p)); }
+inline void store(char *p, Block b) { _mm256_storeu_si256(reinterpret_cast<Block *>(p), b); }
+inline Block splat(char c) { return _mm256_set1_epi8(c); }
+inline Block equal(Block a, Block b) { return _mm256_cmpeq_epi8(a, b); }
+inline Block signed_greater(Block a, Block b) { return _mm256_cmpgt_epi8(a, b); }
+inline Block add_bytes(Block a, Block b) { return _mm256_add_epi8(a, b); }
+inline Block and_bits(Block a, Block b) { return _mm256_and_si256(a, b); }
+inline Block xor_bits(Block a, Block b) { return _mm256_xor_si256(a, b); }
+inline uint32_t mask(Block b) { return static_cast<uint32_t>(_mm256_movemask_epi8(b)); }
+#else
+using Block = __m128i;
+constexpr size_t block_size {16};
+inline Block load(const char *p) { return _mm_loadu_si128(reinterpret_cast<const Block *>(p)); }
+inline Block load_aligned(const char *p) { return _mm_load_si128(reinterpret_cast<const Block *>(p)); }
+inline void store(char *p, Block b) { _mm_storeu_si128(reinterpret_cast<Block *>(p), b); }
+inline Block splat(char c) { return _mm_set1_epi8(c); }
+inline Block equal(Block a, Block b) { return _mm_cmpeq_epi8(a, b); }
+inline Block signed_greater(Block a, Block b) { return _mm_cmpgt_epi8(a, b); }
+inline Block add_bytes(Block a, Block b) { return _mm_add_epi8(a, b); }
+inline Block and_bits(Block a, Block b) { return _mm_and_si128(a, b); }
+inline Block xor_bits(Block a, Block b) { return _mm_xor_si128(a, b); }
+inline uint32_t mask(Block b) { return static_cast<uint32_t>(_mm_movemask_epi8(b)); }
+#endif
+
+inline unsigned lowest_bit(uint32_t m) { return static_cast<unsigned>(countr_zero(m)); }   // one tzcnt / bsf instruction, on every compiler
+
+// true if a whole block starting at p stays inside p's 4 KB memory page, so reading it can't fault even if the string ends earlier
+inline bool block_fits_in_page(const char *p) { return reinterpret_cast<uintptr_t>(p) % 4096 <= 4096 - block_size; }
+
+// bitmask of the first count bytes of a block
+inline uint32_t first_bytes(size_t count) { return static_cast<uint32_t>((uint64_t {1} << count) - 1); }
+
+// 0xff in every byte that is 'a'..'z' (or 'A'..'Z' with from = 'A'). Adding 128 - from moves the range to -128..-103, so one signed compare finds it
+inline Block letters(Block b, char from) {
+  Block shifted = add_bytes(b, splat(static_cast<char>(128 - from)));
+  return signed_greater(splat(static_cast<char>(-128 + 26)), shifted);
+}
+
+inline Block lower_block(Block b) { return xor_bits(b, and_bits(letters(b, 'A'), splat(0x20))); }
+#endif
+
+size_t str_length(const char *s) {
+#ifdef HAVE_SIMD
+  Block zero = splat('\0');
+  if (block_fits_in_page(s))                            // most strings are short: one unaligned block and done
+    if (uint32_t m = mask(equal(load(s), zero)))
+      return lowest_bit(m);
+  size_t misalignment = reinterpret_cast<uintptr_t>(s) % block_size;
+  const char *p = s - misalignment;                     // aligned loads never cross a page
+  uint32_t m = mask(equal(load_aligned(p), zero)) >> misalignment;
+  if (m)
+    return lowest_bit(m);
+  for (p += block_size;; p += block_size)
+    if ((m = mask(equal(load_aligned(p), zero))))
+      return static_cast<size_t>(p - s) + lowest_bit(m);
+#else
+  return scalar_length(s);
+#endif
+}
+
+size_t find_byte(const char *s, size_t n, char c) {
+  size_t i {0};
+#ifdef HAVE_SIMD
+  Block wanted = splat(c);
+  for (; i + block_size <= n; i += block_size)
+    if (uint32_t m = mask(equal(load(s + i), wanted)))
+      return i + lowest_bit(m);
+#endif
+  size_t rest = scalar_find_byte(s + i, n - i, c);
+  return rest == npos ? npos : i + rest;
+}
+
+size_t find(string_view haystack, string_view needle) {
+  size_t n = haystack.size(), m = needle.size();
+  if (m == 0)
+    return 0;
+  if (m > n)
+    return npos;
+  if (m == 1)
+    return find_byte(haystack.data(), n, needle[0]);
+  size_t i {0};
+#ifdef HAVE_SIMD
+  const char *h = haystack.data();
+  Block first = splat(needle[0]), last = splat(needle[m - 1]);
+  for (; i + m - 1 + block_size <= n; i += block_size) {
+    uint32_t candidates = mask(and_bits(equal(load(h + i), first), equal(load(h + i + m - 1), last)));
+    for (; candidates; candidates &= candidates - 1) {  // drop the lowest set bit
+      size_t at = i + lowest_bit(candidates);
+      if (memcmp(h + at + 1, needle.data() + 1, m - 2) == 0)
+        return at;
+    }
+  }
+#endif
+  size_t rest = haystack.substr(i).find(needle);
+  return rest == npos ? npos : i + rest;
+}
+
+void to_upper(char *s, size_t n) {
+  size_t i {0};
+#ifdef HAVE_SIMD
+  for (; i + block_size <= n; i += block_size) {
+    Block b = load(s + i);
+    store(s + i, xor_bits(b, and_bits(letters(b, 'a'), splat(0x20))));
+  }
+#endif
+  scalar_to_upper(s + i, n - i);
+}
+
+void to_lower(char *s, size_t n) {
+  size_t i {0};
+#ifdef HAVE_SIMD
+  for (; i + block_size <= n; i += block_size)
+    store(s + i, lower_block(load(s + i)));
+#endif
+  scalar_to_lower(s + i, n - i);
+}
+
+int icompare(string_view a, string_view b) {
+  size_t i {0};
+#ifdef HAVE_SIMD
+  size_t n = min(a.size(), b.size());
+  for (;; i += block_size) {
+    size_t count = min(n - i, block_size);
+    if (count < block_size && !(block_fits_in_page(a.data() + i) && block_fits_in_page(b.data() + i)))
+      break;                                            // the last few characters sit at the end of a page
+    uint32_t same = mask(equal(lower_block(load(a.data() + i)), lower_block(load(b.data() + i))));
+    if (uint32_t different = ~same & first_bytes(count)) {
+      size_t at = i + lowest_bit(different);
+      unsigned char x = ascii_lower(a[at]), y = ascii_lower(b[at]);
+      return x < y ? -1 : 1;
+    }
+    if (count < block_size)
+      return a.size() < b.size() ? -1 : a.size() > b.size() ? 1 : 0;
+  }
+#endif
+  return scalar_icompare(a.substr(i), b.substr(i));
+}
+
+// the test - random strings at random offsets, every answer compared with the C library
+int sign(int x) { return (x > 0) - (x < 0); }
+
+bool fuzz_test(size_t rounds) {
+  mt19937_64 rng {42};
+  vector<char> buffer(8192);
+  size_t failures {0};
+  auto fail = [&](const char *what, size_t round) {
+    if (++failures <= 10)
+      cout << "  " << what << " differs in round " << round << endl;
+  };
+  for (size_t round {0}; round < rounds; ++round) {
+    // a small alphabet makes matches and near matches common
+    const char alphabet[] = "aAbBzZ@[`{ 09\x80\xff";
+    size_t alphabet_size = 2 + rng() % (sizeof(alphabet) - 2);
+    size_t offset = rng() % 64;
+    size_t length = rng() % 4 == 0 ? rng() % 4000 : rng() % 80;
+    char *s = buffer.data() + offset;
+    for (size_t i {0}; i < length; ++i)
+      s[i] = alphabet[rng() % alphabet_size];
+    s[length] = '\0';
+    string_view text {s, length};
+
+    if (str_length(s) != strlen(s))
+      fail("str_length", round);
+    char c = alphabet[rng() % alphabet_size];
+    const void *found = memchr(s, c, length);
+    if (find_byte(s, length, c) != (found ? static_cast<const char *>(found) - s : npos))
+      fail("find_byte", round);
+
+    size_t needle_length = rng() % 6;
+    string needle;
+    if (length > needle_length && rng() % 2) {
+      needle = string(text.substr(rng() % (length - needle_length), needle_length));
+    } else {
+      for (size_t i {0}; i < needle_length; ++i)
+        needle += alphabet[rng() % alphabet_size];
+    }
+    if (find(text, needle) != text.find(needle))
+      fail("find", round);
+
+    string upper {text}, lower {text}, expected_upper {text}, expected_lower {text};
+    to_upper(upper.data(), upper.size());
+    to_lower(lower.data(), lower.size());
+    for (char &ch : expected_upper)
+      ch = static_cast<char>(toupper(static_cast<unsigned char>(ch)));
+    for (char &ch : expected_lower)
+      ch = static_cast<char>(tolower(static_cast<unsigned char>(ch)));
+    if (upper != expected_upper || lower != expected_lower)
+      fail("to_upper/to_lower", round);
+
+    string other {text};
+    if (!other.empty() && rng() % 2)
+      other[rng() % other.size()] ^= (rng() % 2 ? 0x20 : 0x01);  // flip the case, or change the letter
+    if (rng() % 4 == 0)
+      other.resize(rng() % (other.size() + 1));
+    if (icompare(text, other) != sign(strcasecmp(s, other.c_str())))
+      fail("icompare", round);
+  }
+  cout << rounds << " rounds, " << failures << " failures" << endl;
+  return failures == 0;
+}
+
+template <typename Function>
+double time_seconds(Function function) {
+  auto start = chrono::steady_clock::now();
+  function();
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+volatile size_t sink;                     // keeps the compiler from throwing the results away
+
+void report(const char *name, double library, double simd, double bytes) {
+  cout << "  " << left << setw(12) << name << right << fixed << setprecision(2)
+       << setw(9) << bytes / library / 1e9 << " GB/s" << setw(9) << bytes / simd / 1e9 << " GB/s"
+       << setw(8) << library / simd << "x" << endl;
+}
+
+void benchmark() {
+  cout << "                  library       simd     speedup" << endl;
+
+  // short: a million names of 1..31 characters, one after the other
+  mt19937_64 rng {7};
+  string names;
+  vector<size_t> starts;
+  for (size_t i {0}; i < 1'000'000; ++i) {
+    starts.push_back(names.size());
+    size_t length = 1 + rng() % 31;
+    for (size_t j {0}; j < length; ++j)
+      names += static_cast<char>('a' + rng() % 26);
+    names += '\0';
+  }
+  double bytes = static_cast<double>(names.size());
+  size_t total {0};
+  double library = time_seconds([&]() {
+    for (size_t start : starts)
+      total += strlen(names.data() + start);
+  });
+  double simd = time_seconds([&]() {
+    for (size_t start : starts)
+      total += str_length(names.data() + start);
+  });
+  cout << "short (< 32 characters)" << endl;
+  report("length", library, simd, bytes);
+  vector<string_view> views;                            // lengths known up front, the way fixed_string or std::string keep them
+  for (size_t i {0}; i < starts.size(); ++i)
+    views.emplace_back(names.data() + starts[i], (i + 1 < starts.size() ? starts[i + 1] : names.size()) - starts[i] - 1);
+  library = time_seconds([&]() {
+    for (size_t i {1}; i < views.size(); ++i)
+      total += strcasecmp(views[i - 1].data(), views[i].data()) < 0;
+  });
+  simd = time_seconds([&]() {
+    for (size_t i {1}; i < views.size(); ++i)
+      total += icompare(views[i - 1], views[i]) < 0;
+  });
+  report("icompare", library, simd, bytes);
+
+  // long: one 8 MB string, the character and the needle are at the very end
+  string text(8 << 20, 'x');
+  for (size_t i {0}; i < text.size(); i += 7)
+    text[i] = static_cast<char>('a' + rng() % 26);
+  text.replace(text.size() - 10, 9, "Stroustrup");
+  text.back() = '!';
+  bytes = static_cast<double>(text.size());
+  cout << "long (" << (text.size() >> 20) << " MB)" << endl;
+  library = time_seconds([&]() { total += strlen(text.c_str()); });
+  simd = time_seconds([&]() { total += str_length(text.c_str()); });
+  report("length", library, simd, bytes);
+  library = time_seconds([&]() { total += reinterpret_cast<uintptr_t>(memchr(text.data(), '!', text.size())); });
+  simd = time_seconds([&]() { total += find_byte(text.data(), text.size(), '!'); });
+  report("find_byte", library, simd, bytes);
+  library = time_seconds([&]() { total += text.find("Stroustrup"); });
+  simd = time_seconds([&]() { total += find(text, "Stroustrup"); });
+  report("find", library, simd, bytes);
+  string copy {text};
+  library = time_seconds([&]() {
+    for (char &c : copy)
+      c = static_cast<char>(toupper(static_cast<unsigned char>(c)));
+  });
+  copy = text;
+  simd = time_seconds([&]() { to_upper(copy.data(), copy.size()); });
+  report("to_upper", library, simd, bytes);
+  string other {text};
+  to_upper(other.data(), other.size());
+  library = time_seconds([&]() { total += strcasecmp(text.c_str(), other.c_str()); });
+  simd = time_seconds([&]() { total += icompare(text, other); });
+  report("icompare", library, simd, bytes);
+  sink = total;
+}
+
+int main(int argc, char *argv[]) {
+  string_view mode {argc > 1 ? argv[1] : ""};
+  if (mode == "--test")
+    return fuzz_test(argc > 2 ? stoul(argv[2]) : 1'000'000) ? 0 : 1;
+  if (mode == "--benchmark") {
+    benchmark();
+    return 0;
+  }
+
+  char first_name[20] {"Bjarne"};
+  char last_name[20] {"Stroustrup"};
+  char full_name[50] {};
+  size_t first_length = str_length(first_name);
+  size_t last_length = str_length(last_name);
+  memcpy(full_name, first_name, first_length);           // we know the lengths, so no strcat rescans
+  full_name[first_length] = ' ';
+  memcpy(full_name + first_length + 1, last_name, last_length + 1);
+  size_t full_length = first_length + 1 + last_length;
+
+  cout << full_name << " has " << full_length << " characters" << endl;
+  cout << "\"rou\" found at position " << find({full_name, full_length}, "rou") << endl;
+  cout << "the space is at position " << find_byte(full_name, full_length, ' ') << endl;
+  to_upper(full_name, full_length);
+  cout << "upper case: " << full_name << endl;
+  cout << "compared with \"bjarne stroustrup\" ignoring case: " << icompare(full_name, "bjarne stroustrup") << endl;
+  return 0;
+}
+
+/*
+Using C-style Strings
+In this exercise you will create a program that determines the length of a first name and last name individually and then the length of the entire name through the use of the C-style string functions strlen, strcpy, and strcat.
+Begin by declaring and initializing the C-style string variable first_name to contain "Bjarne".
+Now, declare and initialize a second C-style string variable last_name to contain "Stroustrup".
+You must also declare a third C-style string variable whole_name but do not initialize it yet. Remember that the variable whole_name must be large enough to contain the first and last name with no whitespaces.
+Now, by using the C-style string function strlen, declare and initialize the variable first_name_length to contain the length of the first_name string and the variable last_name_length to contain the length of the last_name string.
+Using the C-style string function strcpy, copy the first_name string into the whole_name string variable.
+Now, by using the C-style string function strcat, concatenate the last_name string at the end of the whole_name string.
+Finally, by using the C-style string function strlen, declare and initialize the variable whole_name_length to contain the length of the whole_name string.
+*/
+char first_name [7] {"Bjarne"};
+char last_name [11] {"Stroustrup"};
+char whole_name [17];
+
+int first_name_length = strlen(first_name);
+int last_name_length = strlen(last_name);
+
+strcpy(whole_name,first_name);
+strcat(whole_name,last_name);
+
+int whole_name_length = strlen(whole_name);
+
+// c++ string : Standard string is a class in the c++ standard template library or stl. We could do an entire course on just the scl, and that course would be very long and complex. So in this video, I'll only talk about the major elements of the c++ string class. In order to use c++ plus strings, you must include the string header file. Strings are in the standard namespace. So in order to use them without using namespace standard, you must prefix them with standard and the scope resolution operator. This is also true for the standard string methods that work with c++ strings. Like c-style strings, c++ strings are stored contiguously in memory. However, unlike c-style strings which are fixed in size, c++ strings are dynamic and can grow and shrink as needed at runtime. C++ strings work with the stream insertion and extraction operators just like most other types in c++. The c++ string class provides a rich set of methods or functions that allow us to manipulate strings easily. Chances are that if you need to do something with the string that functionality is already there for you without having to rewrite it from scratch. C++ strings also work with most of the operators that we're used to for assigning, comparing and so forth. This is a huge advantage over c-style strings since c-style strings don't work well with those operators. Even though c++ strings are preferred in most cases sometimes you need to use c-style strings. Maybe you're interfacing with a library that's been optimized for c-style strings. Well, in this use case, you can still use c++ strings and take advantage of them. And when you need to you can easily convert the c++ string into a c-style string and back again. Like vectors, c++ strings are safer since they provide methods that can bounce check and allow you to find errors in your code so you can fix them before your program goes into production.
+
+// c++ string declaration and initialization
+#include <string>
+string s1; // empty string - Unlike c-style strings, c++ strings are always initialized. In this case, S1 is initialized to an empty string. No garbage and memory to have to worry about.
+string s2 {"Frank"}; // Frank - Notice that frank is a c-style literal, that's okay. It will be converted to a c++ string.
+string s3 {s2}; // Frank - S3 is initialized from S2, so a copy of S2 is created. S2 and S3 will both be Frank, but different Franks in different areas of memory.
+string s4 {"Frank", 3}; // Fra - declaring and initializing S4 from Frank. But I'm only using the first three characters of the string Frank.
+string s5 {s3, 0, 2}; // Fr - initializing S5 from S3 which is Frank. notice the 2 integers that follow the S3 and the initializer. The first integer is the starting index and the second is the length.
+string s6 (10, 'X'); // XXXXXXXXXX - we can initialize the string to a specific number of a specific character. Note that this uses constructor syntax with the parentheses instead of the curlies.
+
+// c++ string assignment
+string s1;
+s1 = "Frank";
+string s2 {"amr"};
+s2 = s1; // s2 is now Frank
+
+// c++ string concatenation
+string part1 {"Frank"};
+string part2 {" amr"};
+string full_name;
 full_name = part1 + part2 + " wow"; // Frank amr wow
 full_name = "Frank" + " amr"; // error - This is because we have two c-style literals. And you can't concatenate c-style literals. It only works for c++ strings. A combination of c++ strings and c-style strings is okay though as
 
@@ -3793,6 +6538,600 @@ int main() {
   return 0;
 }
 
+// Find - thousands of words at once (Aho-Corasick)
+// s1.find(word) looks for one word. To find 1,000 keywords in a large file with find we'd read the whole file 1,000 times. The Aho-Corasick algorithm (by Alfred Aho and Margaret Corasick) reads it once. All keywords go into one trie (a tree with one edge per character), and every node also gets a failure link: the node for the longest suffix of what we've read that is still the start of some keyword. Following the links ahead of time turns the trie into a table: for every state and every character, the next state. Scanning is then one table lookup per character, no matter how many keywords there are, and every state knows which keywords end there (including shorter ones like "is" inside "this").
+// A few details make it fast. Characters that appear in no keyword all share one column of the table (byte_class), which keeps the table small enough for the cache. And while we're in the start state, most characters can't begin a keyword, so a prefilter skips them 16 at a time: with SSSE3 (-march=native) the shuffle instruction looks up the low and the high 4 bits of 16 characters in two small tables at once, a trick known as shufti. Whether that helps depends on the keywords: if they start with letters and the text is all letters there is little to skip.
+// Because the scanner's state is just one number, a file can be read in chunks: the state at the end of one chunk is where the next chunk starts, so a keyword that's split between two chunks is still found. For threads the file is cut into ranges. Each thread starts a little early (the longest keyword minus one character) and only reports the matches that end inside its own range, so every match is reported exactly once and in the same order as a single thread would. Run it as
+//   multi_find keywords.txt file [--threads n] [--count]
+// to print "position keyword" for every match (or only a count per keyword), or with --benchmark [MB] [keywords] to compare it with calling string::find for every keyword.
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <queue>
+#include <thread>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <charconv>
+#ifdef __SSSE3__
+#include <immintrin.h>
+#endif
+using namespace std;
+
+struct Match {
+  uint64_t position;                      // where the keyword starts
+  uint32_t keyword;
+};
+
+class AhoCorasick {
+  static constexpr uint32_t none = UINT32_MAX;
+  vector<string> keywords;
+  size_t longest {0};
+  uint8_t byte_class[256] {};             // 0 for characters that are in no keyword
+  size_t class_count {1};
+  vector<uint32_t> next;                  // next[state * class_count + byte_class[c]]
+  vector<uint32_t> output_begin;          // keywords ending in state s: outputs[output_begin[s]] up to output_begin[s + 1]
+  vector<uint32_t> outputs;
+  bool starts_keyword[256] {};
+  alignas(16) uint8_t low_nibble[16] {}, high_nibble[16] {};  // the prefilter tables
+
+  uint32_t add_state() {
+    next.insert(next.end(), class_count, none);
+    return static_cast<uint32_t>(next.size() / class_count - 1);
+  }
+
+  // first position at or after i whose character may start a keyword
+  size_t skip_to_start(const char *text, size_t i, size_t n) const {
+#ifdef __SSSE3__
+    const __m128i low_table = _mm_load_si128(reinterpret_cast<const __m128i *>(low_nibble));
+    const __m128i high_table = _mm_load_si128(reinterpret_cast<const __m128i *>(high_nibble));
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    for (; i + 16 <= n; i += 16) {
+      __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + i));
+      __m128i low = _mm_shuffle_epi8(low_table, _mm_and_si128(block, nibble));
+      __m128i high = _mm_shuffle_epi8(high_table, _mm_and_si128(_mm_srli_epi16(block, 4), nibble));
+      __m128i hit = _mm_cmpeq_epi8(_mm_and_si128(low, high), _mm_setzero_si128());
+      uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hit)) ^ 0xffff;  // 1 where the character may start a keyword
+      if (mask)
+        return i + static_cast<size_t>(__builtin_ctz(mask));
+    }
+#endif
+    while (i < n && !starts_keyword[static_cast<uint8_t>(text[i])])
+      ++i;
+    return i;
+  }
+
+public:
+  explicit AhoCorasick(vector<string> words) : keywords(move(words)) {
+    for (const string &keyword : keywords)
+      for (char c : keyword)
+        if (byte_class[static_cast<uint8_t>(c)] == 0)
+          byte_class[static_cast<uint8_t>(c)] = static_cast<uint8_t>(class_count++ % 256);
+    if (class_count > 256) {              // every byte value used: give up on sharing columns
+      for (size_t c {0}; c < 256; ++c)
+        byte_class[c] = static_cast<uint8_t>(c);
+      class_count = 256;
+    }
+
+    // the trie, with the keywords that end in every node
+    add_state();
+    vector<vector<uint32_t>> ending(1);
+    for (uint32_t k {0}; k < keywords.size(); ++k) {
+      if (keywords[k].empty())
+        continue;
+      longest = max(longest, keywords[k].size());
+      starts_keyword[static_cast<uint8_t>(keywords[k][0])] = true;
+      uint32_t state {0};
+      for (char c : keywords[k]) {
+        uint32_t &edge = next[state * class_count + byte_class[static_cast<uint8_t>(c)]];
+        if (edge == none) {
+          uint32_t child = add_state();   // may move next, so look the edge up again
+          next[state * class_count + byte_class[static_cast<uint8_t>(c)]] = child;
+          ending.emplace_back();
+          state = child;
+        } else {
+          state = edge;
+        }
+      }
+      ending[state].push_back(k);
+    }
+
+    // breadth first, so a node's failure link is finished before its children need it. A missing edge becomes the failure link's edge
+    size_t states = next.size() / class_count;
+    vector<uint32_t> failure(states, 0);
+    vector<uint32_t> order;
+    queue<uint32_t> pending;
+    for (size_t c {0}; c < class_count; ++c) {
+      uint32_t &edge = next[c];
+      if (edge == none)
+        edge = 0;
+      else
+        pending.push(edge);
+    }
+    while (!pending.empty()) {
+      uint32_t state = pending.front();
+      pending.pop();
+      order.push_back(state);
+      for (size_t c {0}; c < class_count; ++c) {
+        uint32_t &edge = next[state * class_count + c];
+        uint32_t fallback = next[failure[state] * class_count + c];
+        if (edge == none) {
+          edge = fallback;
+        } else {
+          failure[edge] = fallback;
+          pending.push(edge);
+        }
+      }
+    }
+    // the keywords ending in a state: its own (the longest) first, then the ones of its failure link
+    for (uint32_t state : order)
+      ending[state].insert(ending[state].end(), ending[failure[state]].begin(), ending[failure[state]].end());
+    output_begin.reserve(states + 1);
+    for (size_t state {0}; state < states; ++state) {
+      output_begin.push_back(static_cast<uint32_t>(outputs.size()));
+      outputs.insert(outputs.end(), ending[state].begin(), ending[state].end());
+    }
+    output_begin.push_back(static_cast<uint32_t>(outputs.size()));
+
+    // prefilter: a character passes if the bit for its high nibble (mod 8) is set in both tables. Exact for ASCII, an occasional false positive above it is harmless
+    for (size_t c {0}; c < 256; ++c)
+      if (starts_keyword[c]) {
+        uint8_t bit = static_cast<uint8_t>(1u << ((c >> 4) % 8));
+        low_nibble[c & 0x0f] |= bit;
+        high_nibble[c >> 4] |= bit;
+      }
+  }
+
+  size_t size() const { return keywords.size(); }
+  size_t longest_keyword() const { return longest; }
+  const string &keyword(uint32_t k) const { return keywords[k]; }
+
+  // scans text[0, n) that starts at position offset in the whole input, starting in state, and returns the state to continue with.
+  // on_match(Match) is called for every match that ends at or after report_from
+  template <typename Callback>
+  uint32_t scan(const char *text, size_t n, uint32_t state, uint64_t offset, uint64_t report_from, Callback &&on_match) const {
+    const uint32_t *table = next.data();
+    for (size_t i {0}; i < n; ++i) {
+      if (state == 0 && (i = skip_to_start(text, i, n)) == n)
+        break;
+      state = table[state * class_count + byte_class[static_cast<uint8_t>(text[i])]];
+      uint32_t first = output_begin[state], last = output_begin[state + 1];
+      if (first != last && offset + i >= report_from)
+        for (uint32_t o {first}; o < last; ++o)
+          on_match(Match {offset + i + 1 - keywords[outputs[o]].size(), outputs[o]});
+    }
+    return state;
+  }
+};
+
+// all matches in text, using threads. The thread that owns a match is the one whose range contains its last character
+vector<Match> find_all(const AhoCorasick &matcher, string_view text, unsigned threads) {
+  vector<vector<Match>> found(threads);
+  vector<thread> workers;
+  for (unsigned t {0}; t < threads; ++t)
+    workers.emplace_back([&, t]() {
+      size_t begin = text.size() * t / threads, end = text.size() * (t + 1) / threads;
+      size_t start = begin - min(begin, matcher.longest_keyword() - 1);
+      matcher.scan(text.data() + start, end - start, 0, start, begin, [&](Match m) { found[t].push_back(m); });
+    });
+  for (auto &worker : workers)
+    worker.join();
+  vector<Match> all;
+  for (auto &part : found)
+    all.insert(all.end(), part.begin(), part.end());
+  return all;
+}
+
+// the same for a file, read in 1 MB chunks - a match split between two chunks is found because the state carries over
+vector<Match> find_all_in_file(const AhoCorasick &matcher, const string &file_name, unsigned threads) {
+  ifstream probe {file_name, ios::binary | ios::ate};
+  if (!probe)
+    throw runtime_error {"Error opening file " + file_name};
+  uint64_t file_size = static_cast<uint64_t>(probe.tellg());
+  vector<vector<Match>> found(threads);
+  vector<thread> workers;
+  for (unsigned t {0}; t < threads; ++t)
+    workers.emplace_back([&, t]() {
+      uint64_t begin = file_size * t / threads, end = file_size * (t + 1) / threads;
+      uint64_t position = begin - min<uint64_t>(begin, matcher.longest_keyword() - 1);
+      ifstream in {file_name, ios::binary};
+      in.seekg(static_cast<streamoff>(position));
+      vector<char> chunk(1 << 20);
+      uint32_t state {0};
+      while (position < end) {
+        size_t wanted = static_cast<size_t>(min<uint64_t>(chunk.size(), end - position));
+        in.read(chunk.data(), static_cast<streamsize>(wanted));
+        size_t got = static_cast<size_t>(in.gcount());
+        if (got == 0)
+          break;
+        state = matcher.scan(chunk.data(), got, state, position, begin, [&](Match m) { found[t].push_back(m); });
+        position += got;
+      }
+    });
+  for (auto &worker : workers)
+    worker.join();
+  vector<Match> all;
+  for (auto &part : found)
+    all.insert(all.end(), part.begin(), part.end());
+  return all;
+}
+
+// the one keyword at a time way, for comparison: every keyword reads the whole text
+vector<size_t> count_with_find(const vector<string> &keywords, const string &text) {
+  vector<size_t> counts(keywords.size());
+  for (size_t k {0}; k < keywords.size(); ++k)
+    for (size_t position = text.find(keywords[k]); position != string::npos; position = text.find(keywords[k], position + 1))
+      ++counts[k];
+  return counts;
+}
+
+template <typename Function>
+double time_seconds(Function function) {
+  auto start = chrono::steady_clock::now();
+  function();
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+void benchmark(size_t megabytes, size_t keyword_count, unsigned threads) {
+  // text made of words from a vocabulary, keywords picked from the same vocabulary plus some that never occur
+  mt19937_64 rng {2024};
+  auto random_word = [&](size_t min_length, size_t max_length) {
+    string word(min_length + rng() % (max_length - min_length + 1), ' ');
+    for (char &c : word)
+      c = static_cast<char>('a' + rng() % 26);
+    return word;
+  };
+  vector<string> vocabulary;
+  for (size_t i {0}; i < 20'000; ++i)
+    vocabulary.push_back(random_word(3, 10));
+  string text;
+  text.reserve(megabytes << 20);
+  while (text.size() < (megabytes << 20)) {
+    text += vocabulary[rng() % vocabulary.size()];
+    text += rng() % 12 == 0 ? ".\n" : " ";
+  }
+  vector<string> keywords;
+  for (size_t i {0}; i < keyword_count; ++i)
+    keywords.push_back(i % 10 == 9 ? random_word(6, 12) : vocabulary[rng() % vocabulary.size()]);
+
+  cout << megabytes << " MB of text, " << keyword_count << " keywords" << endl;
+  vector<size_t> expected;
+  double find_time = time_seconds([&]() { expected = count_with_find(keywords, text); });
+  AhoCorasick *built {nullptr};
+  double build_time = time_seconds([&]() { built = new AhoCorasick {keywords}; });
+  AhoCorasick &matcher = *built;
+  vector<Match> one, many;
+  double one_time = time_seconds([&]() { one = find_all(matcher, text, 1); });
+  double many_time = time_seconds([&]() { many = find_all(matcher, text, threads); });
+
+  vector<size_t> counts(keywords.size());
+  for (const Match &m : many)
+    ++counts[m.keyword];
+  bool same = counts == expected && one.size() == many.size() && equal(one.begin(), one.end(), many.begin(), [](const Match &a, const Match &b) {
+    return a.position == b.position && a.keyword == b.keyword;
+  });
+
+  cout << fixed << setprecision(3);
+  cout << "string::find per keyword : " << setw(8) << find_time << " s" << endl;
+  cout << "build the automaton      : " << setw(8) << build_time << " s" << endl;
+  cout << "Aho-Corasick, 1 thread(s): " << setw(8) << one_time << " s  (" << setprecision(1) << find_time / one_time << "x)" << setprecision(3) << endl;
+  cout << "Aho-Corasick, " << threads << " thread(s): " << setw(8) << many_time << " s  (" << setprecision(1) << find_time / many_time << "x)" << endl;
+  cout << many.size() << " matches, " << (same ? "identical to string::find" : "DIFFERENT from string::find") << endl;
+  delete built;
+}
+
+int main(int argc, char *argv[]) {
+  vector<string> args(argv + 1, argv + argc);
+  unsigned threads = thread::hardware_concurrency();
+  if (threads == 0)
+    threads = 1;
+  bool count_only {false};
+  vector<string> names;
+  for (size_t i {0}; i < args.size(); ++i) {
+    if (args[i] == "--threads" && i + 1 < args.size())
+      threads = max(1u, static_cast<unsigned>(stoul(args[++i])));
+    else if (args[i] == "--count")
+      count_only = true;
+    else
+      names.push_back(args[i]);
+  }
+
+  if (!names.empty() && names[0] == "--benchmark") {
+    benchmark(names.size() > 1 ? stoul(names[1]) : 16, names.size() > 2 ? stoul(names[2]) : 500, threads);
+    return 0;
+  }
+
+  if (names.size() < 2) {                 // no files: the find demo above, with several words at once
+    string s1 {"The secret word is Boo"};
+    AhoCorasick matcher {{"secret", "word", "is", "Boo", "o", "The secret"}};
+    for (const Match &m : find_all(matcher, s1, 1))
+      cout << "Found " << matcher.keyword(m.keyword) << " at position: " << m.position << endl;
+    return 0;
+  }
+
+  vector<string> keywords;
+  ifstream keyword_file {names[0]};
+  if (!keyword_file) {
+    cerr << "Error opening file " << names[0] << endl;
+    return 1;
+  }
+  for (string line; getline(keyword_file, line);)
+    if (!line.empty())
+      keywords.push_back(line);
+  AhoCorasick matcher {keywords};
+
+  vector<Match> matches;
+  try {
+    matches = find_all_in_file(matcher, names[1], threads);
+  } catch (const runtime_error &ex) {
+    cerr << ex.what() << endl;
+    return 1;
+  }
+
+  if (count_only) {
+    vector<size_t> counts(matcher.size());
+    for (const Match &m : matches)
+      ++counts[m.keyword];
+    for (uint32_t k {0}; k < matcher.size(); ++k)
+      cout << setw(10) << counts[k] << "  " << matcher.keyword(k) << "\n";
+  } else {
+    string buffer;                        // one line per match, written in large pieces
+    char number[24];
+    for (const Match &m : matches) {
+      buffer.append(number, to_chars(number, number + sizeof number, m.position).ptr);
+      buffer += ' ';
+      buffer += matcher.keyword(m.keyword);
+      buffer += '\n';
+      if (buffer.size() > (1 << 20)) {
+        cout.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+        buffer.clear();
+      }
+    }
+    cout.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+  }
+  return 0;
+}
+
+// Comparison - interned strings
+// s1 == s5 and s1 < s2 look at the characters one by one, every time. A program that compares the same few thousand different strings (product names, fruit, tags) billions of times does the same work over and over. Interning does it once: a StringPool keeps exactly one copy of every different string and gives it a number, a 32-bit handle. Interning "Apple" twice gives the same handle, so two interned strings are equal exactly when their handles are, an integer compare. For < the pool sorts its strings once (rank_all) and gives every handle its rank, its place in that order; then a < b is rank[a] < rank[b], also just integers.
+// The characters are stored one after the other in big blocks of memory (an arena) that never move, so the views the pool hands out stay valid as long as the pool lives. The hash table is shared by all threads. Looking up a string that's already there takes no lock: every slot of the table is one atomic 64-bit number holding part of the hash and the handle, written once and never changed. Only adding a new string takes a lock, one of 64 chosen by the hash, so threads adding different strings rarely wait for each other and two threads adding the same string can't both succeed. The table has a fixed size chosen when the pool is made and intern throws length_error when it's full. Run it with --benchmark [distinct strings] [comparisons] to compare handles with std::string.
+#include <iostream>
+#include <iomanip>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+using namespace std;
+
+using Handle = uint32_t;
+
+class StringPool {
+  struct Entry {
+    const char *data;
+    uint32_t length;
+  };
+  static constexpr size_t lock_count {64};
+  static constexpr size_t block_size {1 << 20};
+
+  vector<atomic<uint64_t>> slots;         // 0 = empty, otherwise hash << 32 | handle + 1
+  size_t slot_mask;
+  vector<Entry> entries;                  // by handle, sized up front so it never moves
+  atomic<uint32_t> count {0};
+  mutex locks[lock_count];
+  mutex arena_mutex;
+  vector<unique_ptr<char[]>> blocks;
+  size_t block_used {block_size};
+  vector<uint32_t> ranks;
+
+  static uint32_t hash(string_view s) {  // FNV-1a
+    uint32_t h {2166136261u};
+    for (char c : s)
+      h = (h ^ static_cast<uint8_t>(c)) * 16777619u;
+    return h;
+  }
+  // the handle of s if it's in the table, looked up without a lock
+  bool find(string_view s, uint32_t h, Handle &handle) const {
+    for (size_t i = h & slot_mask;; i = (i + 1) & slot_mask) {
+      uint64_t slot = slots[i].load(memory_order_acquire);
+      if (slot == 0)
+        return false;
+      if (static_cast<uint32_t>(slot >> 32) == h) {
+        Handle candidate = static_cast<Handle>(slot) - 1;
+        if (view(candidate) == s) {
+          handle = candidate;
+          return true;
+        }
+      }
+    }
+  }
+  const char *store(string_view s) {
+    lock_guard<mutex> lock {arena_mutex};
+    if (s.size() > block_size) {          // a block of its own, put in front so the current block stays the last one
+      blocks.insert(blocks.begin(), make_unique<char[]>(s.size()));
+      memcpy(blocks.front().get(), s.data(), s.size());
+      return blocks.front().get();
+    }
+    if (block_size - block_used < s.size()) {
+      blocks.push_back(make_unique<char[]>(block_size));
+      block_used = 0;
+    }
+    char *copy = blocks.back().get() + block_used;
+    memcpy(copy, s.data(), s.size());
+    block_used += s.size();
+    return copy;
+  }
+
+public:
+  explicit StringPool(size_t capacity = 1 << 20) : entries(capacity) {
+    size_t size {16};
+    while (size < capacity * 2)           // at most half full keeps the searches short
+      size *= 2;
+    slots = vector<atomic<uint64_t>>(size);
+    slot_mask = size - 1;
+  }
+
+  Handle intern(string_view s) {
+    uint32_t h = hash(s);
+    Handle handle;
+    if (find(s, h, handle))
+      return handle;
+    lock_guard<mutex> lock {locks[h % lock_count]};  // the same string always gets the same lock
+    if (find(s, h, handle))                         // someone else was faster
+      return handle;
+    handle = count.load();
+    while (true) {
+      if (handle == entries.size())
+        throw length_error {"StringPool is full"};
+      if (count.compare_exchange_weak(handle, handle + 1))
+        break;
+    }
+    entries[handle] = {store(s), static_cast<uint32_t>(s.size())};
+    uint64_t slot = static_cast<uint64_t>(h) << 32 | (handle + 1);
+    for (size_t i = h & slot_mask;; i = (i + 1) & slot_mask) {
+      uint64_t empty {0};
+      if (slots[i].compare_exchange_strong(empty, slot, memory_order_release))  // another lock's string may take a slot at the same time
+        return handle;
+    }
+  }
+
+  string_view view(Handle handle) const { return {entries[handle].data, entries[handle].length}; }
+  size_t size() const { return count; }
+
+  // sorts the strings once. Call it when no other thread is using the pool; strings added later have no rank until it's called again
+  void rank_all() {
+    vector<Handle> order(count);
+    for (Handle h {0}; h < order.size(); ++h)
+      order[h] = h;
+    sort(order.begin(), order.end(), [this](Handle a, Handle b) { return view(a) < view(b); });
+    ranks.assign(order.size(), 0);
+    for (uint32_t rank {0}; rank < order.size(); ++rank)
+      ranks[order[rank]] = rank;
+  }
+  bool less(Handle a, Handle b) const {
+    if (a < ranks.size() && b < ranks.size())
+      return ranks[a] < ranks[b];
+    return view(a) < view(b);
+  }
+  uint32_t rank(Handle handle) const { return ranks[handle]; }
+  const uint32_t *rank_table() const { return ranks.data(); }
+};
+
+template <typename Function>
+double time_seconds(Function function) {
+  auto start = chrono::steady_clock::now();
+  function();
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+void benchmark(size_t distinct, size_t comparisons) {
+  // names that share long beginnings, like real catalogue entries, so comparing characters isn't over after one
+  mt19937_64 rng {11};
+  const char *kinds[] {"Organic Granny Smith Apple ", "Organic Cavendish Banana ", "Kiwi Gold ", "Red Delicious Apple "};
+  vector<string> words;
+  for (size_t i {0}; i < distinct; ++i)
+    words.push_back(kinds[rng() % 4] + to_string(rng() % 100000));
+  vector<uint32_t> picks(comparisons + 1);
+  for (auto &p : picks)
+    p = static_cast<uint32_t>(rng() % distinct);
+  vector<string> strings;
+  strings.reserve(picks.size());
+  for (uint32_t p : picks)
+    strings.push_back(words[p]);          // separate copies, like strings read from a file
+
+  StringPool pool {distinct};
+  vector<Handle> handles(picks.size());
+  unsigned threads = max(1u, thread::hardware_concurrency());
+  double intern_time = time_seconds([&]() {
+    vector<thread> workers;
+    for (unsigned t {0}; t < threads; ++t)
+      workers.emplace_back([&, t]() {
+        for (size_t i = picks.size() * t / threads; i < picks.size() * (t + 1) / threads; ++i)
+          handles[i] = pool.intern(strings[i]);
+      });
+    for (auto &worker : workers)
+      worker.join();
+  });
+  double rank_time = time_seconds([&]() { pool.rank_all(); });
+
+  size_t string_equal {0}, string_less {0}, handle_equal {0}, handle_less {0};
+  double string_equal_time = time_seconds([&]() {
+    for (size_t i {0}; i < comparisons; ++i)
+      string_equal += strings[i] == strings[i + 1];
+  });
+  double handle_equal_time = time_seconds([&]() {
+    for (size_t i {0}; i < comparisons; ++i)
+      handle_equal += handles[i] == handles[i + 1];
+  });
+  double string_less_time = time_seconds([&]() {
+    for (size_t i {0}; i < comparisons; ++i)
+      string_less += strings[i] < strings[i + 1];
+  });
+  const uint32_t *rank = pool.rank_table();
+  double handle_less_time = time_seconds([&]() {
+    for (size_t i {0}; i < comparisons; ++i)
+      handle_less += rank[handles[i]] < rank[handles[i + 1]];
+  });
+
+  bool same = string_equal == handle_equal && string_less == handle_less;
+  for (size_t i {0}; i < picks.size(); ++i)
+    same = same && pool.view(handles[i]) == strings[i];
+  cout << distinct << " different strings, " << comparisons << " comparisons" << fixed << setprecision(1) << endl;
+  cout << "intern " << picks.size() << " strings on " << threads << " thread(s): " << setprecision(3) << intern_time << " s, rank them: " << rank_time << " s" << endl;
+  cout << setprecision(1);
+  cout << "==  std::string " << setw(7) << comparisons / string_equal_time / 1e6 << " M/s   handles " << setw(7) << comparisons / handle_equal_time / 1e6
+       << " M/s  (" << string_equal_time / handle_equal_time << "x)" << endl;
+  cout << "<   std::string " << setw(7) << comparisons / string_less_time / 1e6 << " M/s   ranks   " << setw(7) << comparisons / handle_less_time / 1e6
+       << " M/s  (" << string_less_time / handle_less_time << "x)" << endl;
+  cout << (same ? "same answers" : "DIFFERENT ANSWERS") << endl;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 1 && string_view {argv[1]} == "--benchmark") {
+    benchmark(argc > 2 ? stoul(argv[2]) : 4000, argc > 3 ? stoul(argv[3]) : 100'000'000);
+    return 0;
+  }
+
+  StringPool pool;
+  Handle s1 = pool.intern("Apple");
+  Handle s2 = pool.intern("Banana");
+  Handle s3 = pool.intern("Kiwi");
+  Handle s4 = pool.intern("apple");
+  Handle s5 = pool.intern(string {"Apple"});     // a different string with the same characters: the same handle
+  pool.rank_all();
+
+  cout << boolalpha;
+  cout << pool.view(s1) << " is handle " << s1 << ", " << pool.view(s5) << " is handle " << s5 << endl;
+  cout << pool.view(s1) << " == " << pool.view(s5) << ": " << (s1 == s5) << endl;            // true
+  cout << pool.view(s1) << " == " << pool.view(s2) << ": " << (s1 == s2) << endl;            // false
+  cout << pool.view(s1) << " < " << pool.view(s2) << ": " << pool.less(s1, s2) << endl;      // true
+  cout << pool.view(s2) << " > " << pool.view(s1) << ": " << pool.less(s1, s2) << endl;      // true
+  cout << pool.view(s4) << " < " << pool.view(s5) << ": " << pool.less(s4, s5) << endl;      // false, 'a' comes after 'A'
+  cout << pool.view(s3) << " has rank " << pool.rank(s3) << " of " << pool.size() << endl;
+
+  // a string bigger than a whole arena block, then small ones that go on filling the current block
+  string big(3 << 20, 'x');
+  Handle big_handle = pool.intern(big);
+  Handle after = pool.intern("Cherry");
+  Handle after_2 = pool.intern("Date");
+  bool intact = pool.view(big_handle) == big && pool.view(after) == "Cherry" && pool.view(after_2) == "Date" && pool.intern(big) == big_handle;
+  cout << "a " << big.size() << " character string and two small ones after it: " << (intact ? "stored correctly" : "CORRUPTED") << endl;
+  return intact ? 0 : 1;
+}
+
 /*
 Using C++ Strings - Exercise 1
 In this exercise you will create a program that will be used to reformat a name so that it can be read more easily.
@@ -3816,6 +7155,296 @@ string formatted_full_name = first_name + last_name;
 
 formatted_full_name.insert(7, " ");
 
+// Reformatting millions of names without copying them
+// Every step above makes a new string: the constructor copies "Stephen", substr copies "Hawking", + allocates a third string, and insert moves every character after position 7 to make room. That's fine for one name, but a file with millions of names would spend most of its time in the memory allocator. A string_view is just a pointer and a length into text that lives somewhere else, so taking a piece of it (substr, remove_prefix - the view versions of substr and erase) copies nothing. The pieces are collected in a TextBuilder, which only remembers the views and their total length; when it's done it writes everything in one go, either into a string it sizes once or straight into an output buffer.
+// The batch version reads the file in 4 MB blocks and hands out every line as a view into the block, splits it into words (at spaces and where a capital letter follows a small one, so "StephenHawking" becomes "Stephen" and "Hawking"), and writes the words separated by single spaces into a 4 MB output buffer. The only allocations are the two blocks, made once, whatever the number of names (and once more the first time a name has more than 8 words, see TextBuilder). Run it as
+//   name_formatter [names.txt] [formatted.txt]    (standard input / output without file names)
+//   name_formatter --generate count names.txt     (a test file of random names like AdaLovelace)
+//   name_formatter --benchmark [count]            (the views against substr, + and insert)
+//   name_formatter --check                        (a few tricky names, including a very long one)
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <array>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <stdexcept>
+#include <algorithm>
+using namespace std;
+
+// the first 16 pieces live in the builder itself; a text with more (a name of more than 8 words) goes on in a vector, which keeps its memory through clear() so a long name costs an allocation only the first time
+class TextBuilder {
+  static constexpr size_t inline_pieces {16};
+  array<string_view, inline_pieces> pieces;
+  size_t count {0};
+  vector<string_view> more;
+  size_t length {0};
+public:
+  TextBuilder &operator<<(string_view piece) {
+    if (count < inline_pieces)
+      pieces[count++] = piece;
+    else
+      more.push_back(piece);
+    length += piece.size();
+    return *this;
+  }
+  size_t size() const { return length; }
+  void clear() {
+    count = length = 0;
+    more.clear();
+  }
+  // out must have room for size() characters
+  char *write_to(char *out) const {
+    for (size_t i {0}; i < count; ++i) {
+      memcpy(out, pieces[i].data(), pieces[i].size());
+      out += pieces[i].size();
+    }
+    for (string_view piece : more) {
+      memcpy(out, piece.data(), piece.size());
+      out += piece.size();
+    }
+    return out;
+  }
+  string str() const {                    // exactly one allocation (none at all if it fits in the string itself)
+    string result(length, '\0');
+    write_to(result.data());
+    return result;
+  }
+};
+
+inline bool is_upper(char c) { return c >= 'A' && c <= 'Z'; }
+inline bool is_lower(char c) { return c >= 'a' && c <= 'z'; }
+inline bool is_blank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+// calls word(string_view) for every word of text - separated by blanks, or starting where a capital letter follows a small one
+template <typename Callback>
+void for_each_word(string_view text, Callback &&word) {
+  size_t start {0};
+  for (size_t i {0}; i <= text.size(); ++i) {
+    bool blank = i == text.size() || is_blank(text[i]);
+    bool boundary = !blank && i > 0 && is_upper(text[i]) && is_lower(text[i - 1]);
+    if (blank || boundary) {
+      if (i > start)
+        word(text.substr(start, i - start));
+      start = blank ? i + 1 : i;
+    }
+  }
+}
+
+// "StephenHawking" -> "Stephen Hawking" as pieces of the original text plus single spaces
+void format_name(string_view unformatted, TextBuilder &builder) {
+  builder.clear();
+  for_each_word(unformatted, [&](string_view word) {
+    if (builder.size() > 0)
+      builder << " ";
+    builder << word;
+  });
+}
+
+class LineReader {
+  FILE *in;
+  vector<char> block;
+  size_t used {0}, position {0};
+  bool at_end {false};
+  // keeps the unread part, moved to the front, and reads more after it
+  void refill() {
+    copy(block.begin() + position, block.begin() + used, block.begin());
+    used -= position;
+    position = 0;
+    if (used == block.size())
+      block.resize(block.size() * 2);     // one line longer than the whole block
+    size_t read = fread(block.data() + used, 1, block.size() - used, in);
+    used += read;
+    at_end = read == 0;
+  }
+public:
+  explicit LineReader(FILE *in) : in{in}, block(1 << 22) {}
+  // the next line without its \n, valid until the next call
+  bool next(string_view &line) {
+    while (true) {
+      const char *newline = static_cast<const char *>(memchr(block.data() + position, '\n', used - position));
+      if (newline || (at_end && position < used)) {
+        size_t end = newline ? static_cast<size_t>(newline - block.data()) : used;
+        line = string_view {block.data() + position, end - position};
+        position = newline ? end + 1 : end;
+        return true;
+      }
+      if (at_end)
+        return false;
+      refill();
+    }
+  }
+};
+
+class LineWriter {
+  FILE *out;
+  vector<char> block;
+  size_t used {0};
+public:
+  explicit LineWriter(FILE *out) : out{out}, block(1 << 22) {}
+  ~LineWriter() { flush(); }
+  void write(const TextBuilder &text) {
+    if (block.size() - used < text.size() + 1) {
+      flush();
+      if (block.size() < text.size() + 1)
+        block.resize(text.size() + 1);
+    }
+    char *end = text.write_to(block.data() + used);
+    *end++ = '\n';
+    used = static_cast<size_t>(end - block.data());
+  }
+  void flush() {
+    fwrite(block.data(), 1, used, out);
+    used = 0;
+  }
+};
+
+size_t reformat(FILE *in, FILE *out) {
+  LineReader reader {in};
+  LineWriter writer {out};
+  TextBuilder builder;
+  size_t count {0};
+  for (string_view line; reader.next(line); ++count) {
+    format_name(line, builder);
+    writer.write(builder);
+  }
+  return count;
+}
+
+string random_name(mt19937_64 &rng) {
+  static const char *first[] {"Ada", "Alan", "Grace", "Stephen", "Isaac", "Marie", "Bjarne", "Dennis", "Barbara", "Edsger", "Katherine", "Donald"};
+  static const char *middle[] {"", "", "", "Mary", "Jackson", "Coleman", "Goble", "Ervin"};
+  static const char *last[] {"Lovelace", "Turing", "Hopper", "Hawking", "Newton", "Curie", "Stroustrup", "Ritchie", "Liskov", "Dijkstra", "Johnson", "Knuth", "VonNeumann"};
+  return string {first[rng() % size(first)]} + middle[rng() % size(middle)] + last[rng() % size(last)];
+}
+
+template <typename Function>
+double time_seconds(Function function) {
+  auto start = chrono::steady_clock::now();
+  function();
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+void benchmark(size_t count) {
+  mt19937_64 rng {1};
+  vector<string> names;
+  for (size_t i {0}; i < count; ++i)
+    names.push_back(random_name(rng));
+
+  // the exercise's way: every word is copied out with substr, and + and insert make new strings
+  size_t naive_total {0};
+  double naive = time_seconds([&]() {
+    for (const string &unformatted : names) {
+      string formatted;
+      for_each_word(unformatted, [&](string_view word) {
+        size_t start = static_cast<size_t>(word.data() - unformatted.data());
+        string piece = unformatted.substr(start, word.size());
+        if (!formatted.empty())
+          piece.insert(0, " ");
+        formatted = formatted + piece;
+      });
+      naive_total += formatted.size();
+    }
+  });
+
+  size_t view_total {0};
+  TextBuilder builder;
+  vector<char> out(64);
+  double views = time_seconds([&]() {
+    for (const string &unformatted : names) {
+      format_name(unformatted, builder);
+      view_total += static_cast<size_t>(builder.write_to(out.data()) - out.data());
+    }
+  });
+
+  cout << count << " names" << fixed << setprecision(1) << endl;
+  cout << "substr, + and insert : " << setw(8) << count / naive / 1e6 << " million names/s" << endl;
+  cout << "views and a builder  : " << setw(8) << count / views / 1e6 << " million names/s  (" << naive / views << "x)" << endl;
+  if (naive_total != view_total)
+    cout << "the results differ!" << endl;
+}
+
+// a few names with the result they should give, true if all of them do
+bool check() {
+  string long_name, expected;
+  for (size_t i {0}; i < 40; ++i) {      // 40 words: more pieces than the builder keeps inline
+    long_name += "Word" + string(i % 3, 'x');
+    expected += (i ? " Word" : "Word") + string(i % 3, 'x');
+  }
+  const pair<string, string> cases[] {
+    {"StephenHawking", "Stephen Hawking"},
+    {"  Ada   Lovelace ", "Ada Lovelace"},
+    {"JohnVonNeumann", "John Von Neumann"},
+    {"", ""},
+    {long_name, expected},
+  };
+  TextBuilder builder;
+  bool ok {true};
+  for (const auto &[unformatted, formatted] : cases) {
+    format_name(unformatted, builder);
+    if (builder.str() != formatted) {
+      cout << "FAILED: \"" << unformatted << "\" gave \"" << builder.str() << "\"" << endl;
+      ok = false;
+    }
+  }
+  cout << (ok ? "all names formatted correctly" : "some names FAILED") << endl;
+  return ok;
+}
+
+int main(int argc, char *argv[]) {
+  string_view mode {argc > 1 ? argv[1] : ""};
+  if (mode == "--benchmark") {
+    benchmark(argc > 2 ? stoul(argv[2]) : 10'000'000);
+    return 0;
+  }
+  if (mode == "--check")
+    return check() ? 0 : 1;
+  if (mode == "--generate") {
+    if (argc < 4) {
+      cerr << "usage: " << argv[0] << " --generate count names.txt" << endl;
+      return 1;
+    }
+    FILE *out = fopen(argv[3], "wb");
+    if (!out) {
+      cerr << "Error opening file " << argv[3] << endl;
+      return 1;
+    }
+    mt19937_64 rng {1};
+    string lines;
+    for (size_t i {0}, count = stoul(argv[2]); i < count; ++i) {
+      lines += random_name(rng);
+      lines += '\n';
+      if (lines.size() > (1 << 20)) {
+        fwrite(lines.data(), 1, lines.size(), out);
+        lines.clear();
+      }
+    }
+    fwrite(lines.data(), 1, lines.size(), out);
+    fclose(out);
+    return 0;
+  }
+
+  FILE *in = argc > 1 ? fopen(argv[1], "rb") : stdin;
+  FILE *out = argc > 2 ? fopen(argv[2], "wb") : stdout;
+  if (!in || !out) {
+    cerr << "Error opening file " << (in ? argv[2] : argv[1]) << endl;
+    return 1;
+  }
+  auto start = chrono::steady_clock::now();
+  size_t count = reformat(in, out);
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  cerr << count << " names in " << fixed << setprecision(2) << seconds << " s" << endl;
+  if (in != stdin)
+    fclose(in);
+  if (out != stdout)
+    fclose(out);
+  return 0;
+}
+
 /*
 Using C++ Strings - Exercise 2
 In this exercise you will create a program that will be used in a digital library to format and sort journal entries based on the authors last name. Each entry has room to store only the last name of the author.
@@ -3838,6 +7467,855 @@ if (journal_entry_1 > journal_entry_2)
     journal_entry_1.swap(journal_entry_2);
 */
 
+// Sorting a whole bibliography by the authors' last names
+// The exercise sorts two entries by erasing the first name and comparing what's left with <. For millions of entries that idea gets expensive: sort compares every entry about log2(n) times (27 times for 100 million), and every comparison would look for the last name again and compare it character by character through memory spread all over the heap. Here the work is done once per entry. Every line looks like "Isaac Newton: Principia (1687)" - the author comes before the ':' and the last name is the author's last word. From it we make a 16 byte SortKey: the first 8 characters of the last name packed into one 64-bit number so that comparing two numbers gives the same answer as comparing the characters, and the number of the line. Every comparison is then a single integer compare on a small array instead of a walk through the entries.
+// The keys are sorted in two steps, both using all threads. First a radix pass on the top 16 bits (the first two characters): every thread counts how many of its keys fall into each of the 65536 buckets, the counts tell every thread exactly where its keys go, and they all move them there at the same time without locks. Then the threads take buckets one after another and sort them with std::sort on the prefix; where several keys have the same prefix and the names are longer, the next 8 characters of those names become the prefix and that group is sorted again. Finally the lines are written in the new order straight from the buffer the file was read into - the entries themselves are never copied or moved. --fold ignores case (ASCII letters only, the same on every computer whatever its locale), without it the order is plain byte order like < on strings. Entries with equal last names keep their order from the file. Run it as
+//   journal_sort entries.txt [--fold] [--threads n] [--out sorted.txt]
+//   journal_sort --generate count entries.txt
+//   journal_sort --benchmark [count]      (against std::sort with a comparison that finds the last names every time)
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <chrono>
+#include <algorithm>
+using namespace std;
+
+enum class Collation {bytes, folded};
+
+struct SortKey {
+  uint64_t prefix;                        // the first 8 characters, the first one in the top byte
+  uint32_t index;                         // the line number
+  uint16_t start, length;                 // where the last name is in the line, so a tie doesn't have to look for it again
+};
+
+// "Isaac Newton: Principia (1687)" -> "Newton"
+string_view last_name(string_view entry) {
+  string_view author = entry.substr(0, entry.find(':'));
+  while (!author.empty() && (author.back() == ' ' || author.back() == '\r'))
+    author.remove_suffix(1);
+  size_t space = author.rfind(' ');
+  return space == string_view::npos ? author : author.substr(space + 1);
+}
+
+inline unsigned char fold(unsigned char c) { return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c; }
+
+uint64_t make_prefix(string_view name, Collation collation) {
+  uint64_t prefix {0};
+  for (size_t i {0}; i < 8; ++i) {
+    unsigned char c = i < name.size() ? static_cast<unsigned char>(name[i]) : 0;
+    prefix = (prefix << 8) | (collation == Collation::folded ? fold(c) : c);
+  }
+  return prefix;
+}
+
+// the plain way, one character after the other - only used by the benchmark
+int compare_names(string_view a, string_view b, Collation collation) {
+  size_t n = min(a.size(), b.size());
+  for (size_t i {0}; i < n; ++i) {
+    unsigned char x = static_cast<unsigned char>(a[i]), y = static_cast<unsigned char>(b[i]);
+    if (collation == Collation::folded) {
+      x = fold(x);
+      y = fold(y);
+    }
+    if (x != y)
+      return x < y ? -1 : 1;
+  }
+  return a.size() < b.size() ? -1 : a.size() > b.size() ? 1 : 0;
+}
+
+class JournalSorter {
+  const vector<string_view> &entries;
+  Collation collation;
+  unsigned threads;
+
+  template <typename Work>
+  void in_parallel(size_t count, Work work) {        // work(begin, end, thread) on threads equal ranges of [0, count)
+    vector<thread> workers;
+    for (unsigned t {0}; t < threads; ++t)
+      workers.emplace_back(work, count * t / threads, count * (t + 1) / threads, t);
+    for (auto &worker : workers)
+      worker.join();
+  }
+
+  // sorts keys [first, last) whose names agree on their first depth characters. Equal prefixes go one level deeper with the next 8 characters, so a comparison is always just two integers
+  void sort_range(SortKey *first, SortKey *last, size_t depth) const {
+    std::sort(first, last, [](const SortKey &a, const SortKey &b) {
+      return a.prefix != b.prefix ? a.prefix < b.prefix : a.index < b.index;   // equal names keep their order
+    });
+    for (SortKey *run = first; run != last;) {
+      SortKey *run_end = run + 1;
+      bool longer {run->length > depth + 8};
+      for (; run_end != last && run_end->prefix == run->prefix; ++run_end)
+        longer |= run_end->length > depth + 8;
+      if (run_end - run > 1 && longer) {
+        for (SortKey *key = run; key != run_end; ++key) {
+          size_t skip = min<size_t>(key->length, depth + 8);
+          key->prefix = make_prefix(entries[key->index].substr(key->start + skip, key->length - skip), collation);
+        }
+        sort_range(run, run_end, depth + 8);
+      }
+      run = run_end;
+    }
+  }
+
+public:
+  JournalSorter(const vector<string_view> &entries, Collation collation, unsigned threads)
+    : entries{entries}, collation{collation}, threads{max(1u, threads)} {}
+
+  // the line numbers in sorted order
+  vector<uint32_t> sort() {
+    size_t n = entries.size();
+    vector<SortKey> keys(n);
+    in_parallel(n, [&](size_t begin, size_t end, unsigned) {
+      for (size_t i {begin}; i < end; ++i) {
+        string_view name = last_name(entries[i].substr(0, UINT16_MAX));   // the author has to be in the first 64 KB of the line
+        size_t start = static_cast<size_t>(name.data() - entries[i].data());
+        keys[i] = {make_prefix(name, collation), static_cast<uint32_t>(i), static_cast<uint16_t>(start), static_cast<uint16_t>(name.size())};
+      }
+    });
+
+    // radix pass on the top 16 bits: count, work out where every thread's keys go, move them
+    constexpr size_t buckets {1 << 16};
+    auto bucket = [](const SortKey &key) { return static_cast<size_t>(key.prefix >> 48); };
+    vector<vector<size_t>> counts(threads, vector<size_t>(buckets));
+    in_parallel(n, [&](size_t begin, size_t end, unsigned t) {
+      for (size_t i {begin}; i < end; ++i)
+        ++counts[t][bucket(keys[i])];
+    });
+    vector<size_t> bucket_start(buckets + 1);
+    size_t position {0};
+    for (size_t b {0}; b < buckets; ++b) {
+      bucket_start[b] = position;
+      for (unsigned t {0}; t < threads; ++t) {
+        size_t count = counts[t][b];
+        counts[t][b] = position;          // from now on: where thread t puts its next key of bucket b
+        position += count;
+      }
+    }
+    bucket_start[buckets] = n;
+    vector<SortKey> sorted(n);
+    in_parallel(n, [&](size_t begin, size_t end, unsigned t) {
+      for (size_t i {begin}; i < end; ++i)
+        sorted[counts[t][bucket(keys[i])]++] = keys[i];
+    });
+    keys = vector<SortKey> {};
+
+    // every bucket on its own, the threads take the next unsorted one
+    atomic<size_t> next_bucket {0};
+    in_parallel(threads, [&](size_t, size_t, unsigned) {
+      for (size_t b = next_bucket++; b < buckets; b = next_bucket++)
+        if (bucket_start[b + 1] - bucket_start[b] > 1)
+          sort_range(sorted.data() + bucket_start[b], sorted.data() + bucket_start[b + 1], 0);
+    });
+
+    vector<uint32_t> order(n);
+    in_parallel(n, [&](size_t begin, size_t end, unsigned) {
+      for (size_t i {begin}; i < end; ++i)
+        order[i] = sorted[i].index;
+    });
+    return order;
+  }
+};
+
+// the whole file in memory and a view of every line in it
+bool read_entries(const char *file_name, string &text, vector<string_view> &entries) {
+  FILE *in = fopen(file_name, "rb");
+  if (!in)
+    return false;
+  fseek(in, 0, SEEK_END);
+  text.resize(static_cast<size_t>(ftell(in)));
+  fseek(in, 0, SEEK_SET);
+  size_t read = fread(text.data(), 1, text.size(), in);
+  fclose(in);
+  text.resize(read);
+  for (size_t start {0}; start < text.size();) {
+    const char *newline = static_cast<const char *>(memchr(text.data() + start, '\n', text.size() - start));
+    size_t end = newline ? static_cast<size_t>(newline - text.data()) : text.size();
+    entries.emplace_back(text.data() + start, end - start);
+    start = end + 1;
+  }
+  return true;
+}
+
+void write_entries(FILE *out, const vector<string_view> &entries, const vector<uint32_t> &order) {
+  vector<char> block(1 << 22);
+  size_t used {0};
+  for (uint32_t index : order) {
+    string_view entry = entries[index];
+    if (block.size() - used < entry.size() + 1) {
+      fwrite(block.data(), 1, used, out);
+      used = 0;
+      if (block.size() < entry.size() + 1)
+        block.resize(entry.size() + 1);
+    }
+    memcpy(block.data() + used, entry.data(), entry.size());
+    used += entry.size();
+    block[used++] = '\n';
+  }
+  fwrite(block.data(), 1, used, out);
+}
+
+string random_entry(mt19937_64 &rng) {
+  static const char *first[] {"Isaac", "Ada", "Alan", "Grace", "Marie", "Charles", "Emmy", "Niels", "Rosalind", "Carl"};
+  static const char *syllables[] {"an", "ber", "ci", "dor", "el", "fa", "gun", "ho", "is", "jo", "ka", "li", "mo", "ne", "ov", "pe", "ri", "son", "tur", "wen"};
+  string entry {first[rng() % size(first)]};
+  entry += ' ';
+  size_t start = entry.size();
+  for (size_t i {0}, count = 1 + rng() % 4; i < count; ++i)
+    entry += syllables[rng() % size(syllables)];
+  entry[start] = static_cast<char>(rng() % 8 == 0 ? entry[start] : entry[start] - ('a' - 'A'));  // a few lower case last names
+  entry += ": Collected Papers, volume ";
+  entry += to_string(1 + rng() % 40);
+  return entry;
+}
+
+template <typename Function>
+double time_seconds(Function function) {
+  auto start = chrono::steady_clock::now();
+  function();
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+void benchmark(size_t count, unsigned threads) {
+  mt19937_64 rng {5};
+  string text;
+  for (size_t i {0}; i < count; ++i) {
+    text += random_entry(rng);
+    text += '\n';
+  }
+  vector<string_view> entries;
+  for (size_t start {0}; start < text.size();) {
+    size_t end = text.find('\n', start);
+    entries.emplace_back(text.data() + start, end - start);
+    start = end + 1;
+  }
+
+  cout << count << " entries" << fixed << setprecision(2) << endl;
+  for (Collation collation : {Collation::bytes, Collation::folded}) {
+    vector<uint32_t> expected(count);
+    for (uint32_t i {0}; i < count; ++i)
+      expected[i] = i;
+    double plain = time_seconds([&]() {
+      stable_sort(expected.begin(), expected.end(), [&](uint32_t a, uint32_t b) {
+        return compare_names(last_name(entries[a]), last_name(entries[b]), collation) < 0;
+      });
+    });
+    vector<uint32_t> one, many;
+    double one_time = time_seconds([&]() { one = JournalSorter {entries, collation, 1}.sort(); });
+    double many_time = time_seconds([&]() { many = JournalSorter {entries, collation, threads}.sort(); });
+    cout << (collation == Collation::bytes ? "byte order" : "folded") << endl;
+    cout << "  std::stable_sort, names found per comparison : " << setw(7) << plain << " s" << endl;
+    cout << "  sort keys, 1 thread(s)                       : " << setw(7) << one_time << " s  (" << plain / one_time << "x)" << endl;
+    cout << "  sort keys, " << setw(2) << threads << " thread(s)                      : " << setw(7) << many_time << " s  (" << plain / many_time << "x)" << endl;
+    cout << "  " << (one == expected && many == expected ? "same order" : "DIFFERENT ORDER") << endl;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  vector<string> args(argv + 1, argv + argc);
+  unsigned threads = thread::hardware_concurrency();
+  if (threads == 0)
+    threads = 1;
+  Collation collation {Collation::bytes};
+  string out_name;
+  vector<string> names;
+  for (size_t i {0}; i < args.size(); ++i) {
+    if (args[i] == "--threads" && i + 1 < args.size())
+      threads = max(1u, static_cast<unsigned>(stoul(args[++i])));
+    else if (args[i] == "--fold")
+      collation = Collation::folded;
+    else if (args[i] == "--out" && i + 1 < args.size())
+      out_name = args[++i];
+    else
+      names.push_back(args[i]);
+  }
+
+  if (!names.empty() && names[0] == "--benchmark") {
+    benchmark(names.size() > 1 ? stoul(names[1]) : 10'000'000, threads);
+    return 0;
+  }
+  if (!names.empty() && names[0] == "--generate" && names.size() == 3) {
+    FILE *out = fopen(names[2].c_str(), "wb");
+    if (!out) {
+      cerr << "Error opening file " << names[2] << endl;
+      return 1;
+    }
+    mt19937_64 rng {5};
+    string lines;
+    for (size_t i {0}, count = stoul(names[1]); i < count; ++i) {
+      lines += random_entry(rng);
+      lines += '\n';
+      if (lines.size() > (1 << 20)) {
+        fwrite(lines.data(), 1, lines.size(), out);
+        lines.clear();
+      }
+    }
+    fwrite(lines.data(), 1, lines.size(), out);
+    fclose(out);
+    return 0;
+  }
+  if (names.size() != 1) {
+    cerr << "usage: " << argv[0] << " entries.txt [--fold] [--threads n] [--out sorted.txt]" << endl;
+    return 1;
+  }
+
+  string text;
+  vector<string_view> entries;
+  auto start = chrono::steady_clock::now();
+  if (!read_entries(names[0].c_str(), text, entries)) {
+    cerr << "Error opening file " << names[0] << endl;
+    return 1;
+  }
+  if (entries.size() > UINT32_MAX) {
+    cerr << "Too many entries" << endl;
+    return 1;
+  }
+  auto read_at = chrono::steady_clock::now();
+  vector<uint32_t> order = JournalSorter {entries, collation, threads}.sort();
+  auto sorted_at = chrono::steady_clock::now();
+  FILE *out = out_name.empty() ? stdout : fopen(out_name.c_str(), "wb");
+  if (!out) {
+    cerr << "Error opening file " << out_name << endl;
+    return 1;
+  }
+  write_entries(out, entries, order);
+  if (out != stdout)
+    fclose(out);
+  cerr << entries.size() << " entries: read " << fixed << setprecision(2) << chrono::duration<double>(read_at - start).count()
+       << " s, sort " << chrono::duration<double>(sorted_at - read_at).count() << " s on " << threads << " thread(s), write "
+       << chrono::duration<double>(chrono::steady_clock::now() - sorted_at).count() << " s" << endl;
+  return 0;
+}
+
+// Sorting a bibliography that doesn't fit in memory (external merge sort)
+// journal_sort above reads the whole file into memory. A file of hundreds of GB doesn't fit, so it's sorted in two phases instead. First the file is cut into pieces that do fit (the memory budget, --memory in MB, shared by the threads): every thread takes the next piece, sorts it the same way (by last name, equal names keep their order) and writes it to a temporary file, a sorted run. Then all runs are merged: we only need the first line of every run, and the smallest of those is the next line of the output.
+// Finding the smallest of k lines over and over is the job of a loser tree (a tournament): the runs are the players, every match is a comparison, and every node of the tree remembers the loser of the match played there while the winner moves up. When the winner's run hands over its next line, only the matches on the way from that run to the top are played again, log2(k) comparisons instead of k. The disk is kept busy at the same time: every run and the output have two buffers, and while the merge works through one buffer the other one is being read (or written) by another thread with std::async. If there are too many runs for the buffers to be big enough, groups of runs are merged into bigger runs first. While it works, a line of progress (how much is read or written and how fast) is printed to the error output every second. Run it as
+//   external_sort entries.txt sorted.txt [--memory MB] [--threads n] [--fold] [--temp directory]
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <future>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+using namespace std;
+
+enum class Collation {bytes, folded};
+
+// "Isaac Newton: Principia (1687)" -> "Newton"
+string_view last_name(string_view entry) {
+  string_view author = entry.substr(0, entry.find(':'));
+  while (!author.empty() && (author.back() == ' ' || author.back() == '\r'))
+    author.remove_suffix(1);
+  size_t space = author.rfind(' ');
+  return space == string_view::npos ? author : author.substr(space + 1);
+}
+
+inline unsigned char fold(unsigned char c) { return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c; }
+
+uint64_t make_prefix(string_view name, Collation collation) {
+  uint64_t prefix {0};
+  for (size_t i {0}; i < 8; ++i) {
+    unsigned char c = i < name.size() ? static_cast<unsigned char>(name[i]) : 0;
+    prefix = (prefix << 8) | (collation == Collation::folded ? fold(c) : c);
+  }
+  return prefix;
+}
+
+int compare_names(string_view a, string_view b, Collation collation) {
+  size_t n = min(a.size(), b.size());
+  for (size_t i {0}; i < n; ++i) {
+    unsigned char x = static_cast<unsigned char>(a[i]), y = static_cast<unsigned char>(b[i]);
+    if (collation == Collation::folded) {
+      x = fold(x);
+      y = fold(y);
+    }
+    if (x != y)
+      return x < y ? -1 : 1;
+  }
+  return a.size() < b.size() ? -1 : a.size() > b.size() ? 1 : 0;
+}
+
+// a line with its sort key worked out once
+struct Keyed {
+  string_view line;
+  string_view name;
+  uint64_t prefix {0};
+  size_t order {0};                       // line number in a piece, run number in the merge: decides between equal names
+};
+
+inline bool keyed_less(const Keyed &a, const Keyed &b, Collation collation) {
+  if (a.prefix != b.prefix)
+    return a.prefix < b.prefix;
+  if (int c = compare_names(a.name, b.name, collation))
+    return c < 0;
+  return a.order < b.order;
+}
+
+Keyed make_keyed(string_view line, size_t order, Collation collation) {
+  string_view name = last_name(line);
+  return {line, name, make_prefix(name, collation), order};
+}
+
+// bytes read and written so far, printed once a second by its own thread - while it runs, every other message goes through it too, so lines never interleave
+class Progress {
+  atomic<uint64_t> read {0}, written {0};
+  atomic<const char *> phase {"runs"};
+  uint64_t total;
+  mutex m;
+  condition_variable wake_up;
+  vector<string> messages;
+  bool stopping {false};
+  thread reporter;
+  void report() {
+    auto start = chrono::steady_clock::now();
+    auto next_report = start + chrono::seconds {1};
+    unique_lock<mutex> lock {m};
+    while (true) {
+      wake_up.wait_until(lock, next_report, [this]() { return stopping || !messages.empty(); });
+      for (const string &message : messages)
+        cerr << message << endl;
+      messages.clear();
+      if (stopping)
+        return;
+      auto now = chrono::steady_clock::now();
+      if (now < next_report)
+        continue;
+      next_report = now + chrono::seconds {1};
+      double seconds = chrono::duration<double>(now - start).count();
+      uint64_t r = read, w = written;
+      cerr << fixed << setprecision(0) << "[" << phase.load() << "] " << total / 1e6 << " MB input, " << r / 1e6 << " MB read and "
+           << w / 1e6 << " MB written so far, " << (r + w) / 1e6 / seconds << " MB/s after " << seconds << " s" << endl;
+    }
+  }
+public:
+  explicit Progress(uint64_t total) : total{total}, reporter{&Progress::report, this} {}
+  ~Progress() {
+    {
+      lock_guard<mutex> lock {m};
+      stopping = true;
+    }
+    wake_up.notify_one();
+    reporter.join();                      // after it has printed the last messages
+  }
+  void message(string text) {
+    {
+      lock_guard<mutex> lock {m};
+      messages.push_back(move(text));
+    }
+    wake_up.notify_one();
+  }
+  void set_phase(const char *name) { phase = name; }
+  void add_read(uint64_t bytes) { read += bytes; }
+  void add_written(uint64_t bytes) { written += bytes; }
+};
+
+string seconds_text(chrono::steady_clock::duration d) {
+  char text[32];
+  snprintf(text, sizeof text, "%.2f s", chrono::duration<double>(d).count());
+  return text;
+}
+
+// the temporary files of a sort, removed when it goes out of scope - also when an exception unwinds past it
+class TempFiles {
+  mutex m;
+  vector<string> names;
+public:
+  TempFiles() = default;
+  TempFiles(const TempFiles &) = delete;
+  TempFiles &operator=(const TempFiles &) = delete;
+  ~TempFiles() {
+    for (const string &name : names)
+      remove(name.c_str());               // the ones already merged and removed just fail quietly
+  }
+  // before the file is created, so a half written one is removed as well
+  void add(const string &name) {
+    lock_guard<mutex> lock {m};
+    names.push_back(name);
+  }
+};
+
+// the input cut into pieces that end at a line break, handed out to the threads one at a time
+class PieceReader {
+  FILE *in;
+  mutex m;
+  string carry;                           // the beginning of a line that didn't fit in the last piece
+  size_t next_piece {0};
+  Progress &progress;
+public:
+  PieceReader(FILE *in, Progress &progress) : in{in}, progress{progress} {}
+  // fills piece with whole lines and tells which piece it was, false when the input is used up
+  bool next(vector<char> &piece, size_t &size, size_t &number) {
+    lock_guard<mutex> lock {m};
+    if (piece.size() < carry.size() * 2)
+      piece.resize(carry.size() * 2);     // a line bigger than half a piece
+    memcpy(piece.data(), carry.data(), carry.size());
+    size = carry.size();
+    carry.clear();
+    while (true) {
+      size_t read = fread(piece.data() + size, 1, piece.size() - size, in);
+      progress.add_read(read);
+      size += read;
+      if (size < piece.size())
+        break;                            // the end of the input
+      char *last_newline = piece.data() + size;
+      while (last_newline != piece.data() && last_newline[-1] != '\n')
+        --last_newline;
+      if (last_newline != piece.data()) { // the last line may continue in the next piece
+        carry.assign(last_newline, piece.data() + size);
+        size = static_cast<size_t>(last_newline - piece.data());
+        break;
+      }
+      piece.resize(piece.size() * 2);     // not even one whole line yet
+    }
+    if (size == 0)
+      return false;
+    number = next_piece++;
+    return true;
+  }
+};
+
+// writes one buffer to disk with std::async while the caller fills the other one
+class AsyncWriter {
+  FILE *out;
+  vector<char> buffers[2];
+  int current {0};
+  size_t used {0};
+  future<void> pending;
+  Progress &progress;
+  void write_current() {
+    if (pending.valid())
+      pending.get();
+    pending = async(launch::async, [this, buffer = buffers[current].data(), size = used]() {
+      if (fwrite(buffer, 1, size, out) != size)
+        throw runtime_error {"Error writing"};
+      progress.add_written(size);
+    });
+    current ^= 1;
+    used = 0;
+  }
+public:
+  AsyncWriter(FILE *out, size_t buffer_size, Progress &progress) : out{out}, buffers{vector<char>(buffer_size), vector<char>(buffer_size)}, progress{progress} {}
+  void write_line(string_view line) {
+    if (buffers[current].size() - used < line.size() + 1) {
+      write_current();
+      if (buffers[current].size() < line.size() + 1)
+        buffers[current].resize(line.size() + 1);
+    }
+    memcpy(buffers[current].data() + used, line.data(), line.size());
+    used += line.size();
+    buffers[current][used++] = '\n';
+  }
+  void finish() {
+    write_current();
+    pending.get();
+  }
+};
+
+// reads a run one buffer ahead with std::async and hands out its lines
+class RunReader {
+  FILE *in;
+  vector<char> buffers[2];
+  int current {0};
+  size_t size {0}, position {0};
+  future<size_t> pending;
+  string carry;                           // a line split between two buffers
+  bool carried {false};
+  Progress &progress;
+  void read_ahead(int buffer) {
+    pending = async(launch::async, [this, buffer]() { return fread(buffers[buffer].data(), 1, buffers[buffer].size(), in); });
+  }
+  void switch_buffers() {
+    size = pending.get();
+    position = 0;
+    progress.add_read(size);
+    current ^= 1;
+    if (size > 0)
+      read_ahead(current ^ 1);            // the buffer we just finished with
+  }
+public:
+  RunReader(FILE *in, size_t buffer_size, Progress &progress) : in{in}, buffers{vector<char>(buffer_size), vector<char>(buffer_size)}, current{1}, progress{progress} {
+    read_ahead(0);
+    switch_buffers();
+  }
+  ~RunReader() {
+    if (pending.valid())
+      pending.wait();
+    fclose(in);
+  }
+  // the next line, valid until the next call
+  bool next(string_view &line) {
+    if (carried) {
+      carry.clear();
+      carried = false;
+    }
+    while (true) {
+      const char *start = buffers[current].data() + position;
+      const char *newline = static_cast<const char *>(memchr(start, '\n', size - position));
+      if (newline) {
+        position = static_cast<size_t>(newline - buffers[current].data()) + 1;
+        if (carry.empty()) {
+          line = string_view {start, static_cast<size_t>(newline - start)};
+        } else {
+          carry.append(start, newline);
+          line = carry;
+          carried = true;
+        }
+        return true;
+      }
+      carry.append(start, size - position);
+      if (size == 0) {                    // end of the run
+        line = carry;
+        carried = true;
+        return !carry.empty();
+      }
+      switch_buffers();
+    }
+  }
+};
+
+// a tournament between k runs: tree[0] is the run with the smallest line, every other node holds the loser of the match played there
+class LoserTree {
+  vector<size_t> tree;
+  vector<Keyed> &heads;
+  vector<bool> &done;
+  Collation collation;
+  bool beats(size_t a, size_t b) const {  // finished runs lose against everything
+    if (done[a] || done[b])
+      return !done[a];
+    return keyed_less(heads[a], heads[b], collation);
+  }
+  size_t play(size_t node) {              // the leaves are nodes k .. 2k-1
+    size_t k = heads.size();
+    if (node >= k)
+      return node - k;
+    size_t left = play(2 * node), right = play(2 * node + 1);
+    bool left_wins = beats(left, right);
+    tree[node] = left_wins ? right : left;
+    return left_wins ? left : right;
+  }
+public:
+  LoserTree(vector<Keyed> &heads, vector<bool> &done, Collation collation) : tree(max<size_t>(heads.size(), 1)), heads{heads}, done{done}, collation{collation} {
+    tree[0] = heads.size() <= 1 ? 0 : play(1);
+  }
+  size_t winner() const { return tree[0]; }
+  // the winner's run has a new first line: play its way up again
+  void replay() {
+    size_t k = heads.size();
+    size_t winner = tree[0];
+    for (size_t node = (winner + k) / 2; node >= 1; node /= 2)
+      if (beats(tree[node], winner))
+        swap(tree[node], winner);
+    tree[0] = winner;
+  }
+};
+
+void merge_runs(const vector<string> &runs, const string &output, size_t memory, Collation collation, Progress &progress) {
+  FILE *out = fopen(output.c_str(), "wb");
+  if (!out)
+    throw runtime_error {"Error opening file " + output};
+  size_t buffer_size = clamp<size_t>(memory / (2 * (runs.size() + 1)), 64 << 10, 8 << 20);   // more than 8 MB doesn't make the disk any faster
+  vector<unique_ptr<RunReader>> readers;
+  vector<Keyed> heads(runs.size());
+  vector<bool> done(runs.size());
+  for (size_t r {0}; r < runs.size(); ++r) {
+    FILE *in = fopen(runs[r].c_str(), "rb");
+    if (!in)
+      throw runtime_error {"Error opening file " + runs[r]};
+    readers.push_back(make_unique<RunReader>(in, buffer_size, progress));
+    string_view line;
+    done[r] = !readers[r]->next(line);
+    heads[r] = make_keyed(line, r, collation);
+  }
+  AsyncWriter writer {out, buffer_size, progress};
+  LoserTree tree {heads, done, collation};
+  for (size_t r = tree.winner(); !runs.empty() && !done[r]; r = tree.winner()) {
+    writer.write_line(heads[r].line);
+    string_view line;
+    done[r] = !readers[r]->next(line);
+    heads[r] = make_keyed(line, r, collation);
+    tree.replay();
+  }
+  writer.finish();
+  fclose(out);
+}
+
+// a line of a piece while it's being sorted - 24 bytes, so the keys of a piece of short lines take about as much memory as the lines
+struct RunLine {
+  uint64_t prefix;
+  uint32_t start, length;                 // in the piece, which is at most 4 GB
+  uint16_t name_start, name_length;       // in the line, the author has to be in its first 64 KB
+};
+
+// sorts the lines of one piece and writes them to a run file
+void write_run(const vector<char> &piece, size_t size, const string &file_name, Collation collation, Progress &progress) {
+  vector<RunLine> lines;
+  for (size_t start {0}; start < size;) {
+    const char *newline = static_cast<const char *>(memchr(piece.data() + start, '\n', size - start));
+    size_t end = newline ? static_cast<size_t>(newline - piece.data()) : size;
+    string_view line {piece.data() + start, end - start};
+    string_view name = last_name(line.substr(0, UINT16_MAX));
+    lines.push_back({make_prefix(name, collation), static_cast<uint32_t>(start), static_cast<uint32_t>(line.size()),
+                     static_cast<uint16_t>(name.data() - line.data()), static_cast<uint16_t>(name.size())});
+    start = end + 1;
+  }
+  auto name_of = [&](const RunLine &l) { return string_view {piece.data() + l.start + l.name_start, l.name_length}; };
+  sort(lines.begin(), lines.end(), [&](const RunLine &a, const RunLine &b) {
+    if (a.prefix != b.prefix)
+      return a.prefix < b.prefix;
+    if (int c = compare_names(name_of(a), name_of(b), collation))
+      return c < 0;
+    return a.start < b.start;             // equal names keep their order
+  });
+  FILE *out = fopen(file_name.c_str(), "wb");
+  if (!out)
+    throw runtime_error {"Error opening file " + file_name};
+  vector<char> block(1 << 22);
+  size_t used {0};
+  for (const RunLine &l : lines) {
+    string_view line {piece.data() + l.start, l.length};
+    if (block.size() - used < line.size() + 1) {
+      fwrite(block.data(), 1, used, out);
+      progress.add_written(used);
+      used = 0;
+      if (block.size() < line.size() + 1)
+        block.resize(line.size() + 1);
+    }
+    memcpy(block.data() + used, line.data(), line.size());
+    used += line.size();
+    block[used++] = '\n';
+  }
+  fwrite(block.data(), 1, used, out);
+  progress.add_written(used);
+  if (fclose(out) != 0)
+    throw runtime_error {"Error writing " + file_name};
+}
+
+int main(int argc, char *argv[]) {
+  vector<string> args(argv + 1, argv + argc);
+  unsigned threads = thread::hardware_concurrency();
+  if (threads == 0)
+    threads = 1;
+  size_t memory {1024};                   // MB
+  Collation collation {Collation::bytes};
+  string temp_directory;
+  vector<string> names;
+  for (size_t i {0}; i < args.size(); ++i) {
+    if (args[i] == "--threads" && i + 1 < args.size())
+      threads = max(1u, static_cast<unsigned>(stoul(args[++i])));
+    else if (args[i] == "--memory" && i + 1 < args.size())
+      memory = max<size_t>(stoul(args[++i]), 1);
+    else if (args[i] == "--fold")
+      collation = Collation::folded;
+    else if (args[i] == "--temp" && i + 1 < args.size())
+      temp_directory = args[++i];
+    else
+      names.push_back(args[i]);
+  }
+  if (names.size() != 2) {
+    cerr << "usage: " << argv[0] << " entries.txt sorted.txt [--memory MB] [--threads n] [--fold] [--temp directory]" << endl;
+    return 1;
+  }
+  memory <<= 20;
+  if (temp_directory.empty())
+    temp_directory = filesystem::temp_directory_path().string();
+
+  FILE *in = fopen(names[0].c_str(), "rb");
+  if (!in) {
+    cerr << "Error opening file " << names[0] << endl;
+    return 1;
+  }
+  uint64_t total = filesystem::file_size(names[0]);
+  auto start = chrono::steady_clock::now();
+  vector<string> runs;
+  TempFiles temp_files;
+  try {
+    Progress progress {total};
+
+    // phase 1: sorted runs, every thread with its share of the memory, half for the piece and half for its keys
+    PieceReader pieces {in, progress};
+    mutex runs_mutex;
+    exception_ptr failure;
+    string prefix = (filesystem::path {temp_directory} / ("external_sort." + to_string(chrono::steady_clock::now().time_since_epoch().count()) + ".")).string();
+    vector<thread> workers;
+    for (unsigned t {0}; t < threads; ++t)
+      workers.emplace_back([&]() {
+        try {
+          size_t piece_size = min<uint64_t>(memory / threads / 2, total / threads + (1 << 20));   // no bigger than needed for a small file
+          vector<char> piece(clamp<size_t>(piece_size, 1 << 20, UINT32_MAX));
+          size_t size, number;
+          while (pieces.next(piece, size, number)) {
+            string file_name = prefix + to_string(number);
+            {
+              lock_guard<mutex> lock {runs_mutex};
+              if (runs.size() <= number)
+                runs.resize(number + 1);
+              runs[number] = file_name;     // in input order, so equal names stay in order in the merge
+            }
+            temp_files.add(file_name);
+            write_run(piece, size, file_name, collation, progress);
+          }
+        } catch (...) {
+          lock_guard<mutex> lock {runs_mutex};
+          failure = current_exception();
+        }
+      });
+    for (auto &worker : workers)
+      worker.join();
+    fclose(in);
+    in = nullptr;
+    if (failure)
+      rethrow_exception(failure);
+    auto runs_done = chrono::steady_clock::now();
+    progress.message(to_string(runs.size()) + " sorted runs in " + seconds_text(runs_done - start));
+
+    // phase 2: merge. Every run needs two buffers; with too many runs for buffers of 1 MB, merge groups of neighbours first
+    size_t fan_in = max<size_t>(memory / (2 << 20), 2);
+    for (size_t pass {1}; runs.size() > fan_in; ++pass) {
+      progress.set_phase("merge pass");
+      vector<string> merged;
+      for (size_t first {0}; first < runs.size(); first += fan_in) {
+        vector<string> group(runs.begin() + static_cast<ptrdiff_t>(first), runs.begin() + static_cast<ptrdiff_t>(min(first + fan_in, runs.size())));
+        merged.push_back(prefix + "pass" + to_string(pass) + "." + to_string(merged.size()));
+        temp_files.add(merged.back());
+        merge_runs(group, merged.back(), memory, collation, progress);
+        for (const string &run : group)
+          remove(run.c_str());
+      }
+      runs = merged;
+    }
+    progress.set_phase("merge");
+    merge_runs(runs, names[1], memory, collation, progress);
+    progress.message("merged into " + names[1] + " in " + seconds_text(chrono::steady_clock::now() - runs_done));
+  } catch (const exception &ex) {
+    cerr << ex.what() << endl;            // progress is gone by now, its thread has stopped
+    if (in)
+      fclose(in);
+    return 1;                             // temp_files removes the runs and pass files
+  }
+  cerr << fixed << setprecision(2) << total / 1e6 << " MB sorted in " << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s" << endl;
+  return 0;
+}
+
 // Challenge - Substitution Cipher
 /*
 A simple and very old method of sending secret messages is the substitution cipher.
@@ -3913,6 +8391,182 @@ int main() {
   return 0;
 }
 
+// Building strings without a trip to the memory allocator for every piece
+// s5 + " and " + s2 + " juice" makes a temporary string at the first +, and every + after it may have to move the characters into a bigger piece of memory. The cipher above does the same one character at a time: encrypted_message += new_char grows the string whenever it runs out of room (doubling its capacity each time, so about log2(n) allocations and copies for n characters). When we know all the pieces up front there is a better way: add up their lengths, reserve that much once and append them - that's what concat below does (and pmr_concat, for the arena strings below), for any mix of strings, string_views, C-style strings and characters.
+// The second tool is std::pmr (polymorphic memory resources, C++17). A pmr::string is a normal string that gets its memory from a memory_resource we choose. A monotonic_buffer_resource is an arena: it hands out memory by moving a pointer forward through a buffer (a local array here, more from the heap only if that runs out), and never frees anything on its own. All the strings of one request come from the arena and it throws away everything at once when it goes out of scope - one cheap operation instead of one delete per string. The cipher also gets a lookup table of 256 characters instead of a find per character, and writes into a string that already has the right size. Run it with --benchmark [requests] to count allocations (every operator new is counted) and time the old and new ways.
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <memory_resource>
+#include <array>
+#include <new>
+#include <chrono>
+using namespace std;
+
+// counts heap allocations, so we can see how many each version makes
+size_t allocation_count {0};
+void *operator new(size_t size) {
+  ++allocation_count;
+  if (void *p = malloc(size))
+    return p;
+  throw bad_alloc {};
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+inline size_t piece_length(char) { return 1; }
+inline size_t piece_length(string_view s) { return s.size(); }
+template <typename Result>
+void append_piece(Result &out, char c) { out += c; }
+template <typename Result>
+void append_piece(Result &out, string_view s) { out.append(s.data(), s.size()); }
+
+// all the pieces in one string with exactly one allocation (none if it fits in the string itself or the arena has room)
+template <typename Result, typename... Pieces>
+void concat_into(Result &out, const Pieces &... pieces) {
+  out.clear();
+  out.reserve((piece_length(pieces) + ...));
+  (append_piece(out, pieces), ...);
+}
+
+template <typename... Pieces>
+string concat(const Pieces &... pieces) {
+  string result;
+  concat_into(result, pieces...);
+  return result;
+}
+
+// the same, with the memory from an arena
+template <typename... Pieces>
+pmr::string pmr_concat(pmr::memory_resource *arena, const Pieces &... pieces) {
+  pmr::string result {arena};
+  concat_into(result, pieces...);
+  return result;
+}
+
+class Cipher {
+  array<char, 256> encrypt_table, decrypt_table;
+  static string_view apply(const array<char, 256> &table, string_view message, pmr::string &out) {
+    out.resize(message.size());           // one allocation of the right size, then no more
+    for (size_t i {0}; i < message.size(); ++i)
+      out[i] = table[static_cast<unsigned char>(message[i])];
+    return out;
+  }
+public:
+  Cipher(string_view alphabet, string_view key) {
+    for (size_t c {0}; c < 256; ++c)
+      encrypt_table[c] = decrypt_table[c] = static_cast<char>(c);   // characters not in the alphabet stay as they are
+    for (size_t i {0}; i < alphabet.size() && i < key.size(); ++i) {
+      encrypt_table[static_cast<unsigned char>(alphabet[i])] = key[i];
+      decrypt_table[static_cast<unsigned char>(key[i])] = alphabet[i];
+    }
+  }
+  string_view encrypt(string_view message, pmr::string &out) const { return apply(encrypt_table, message, out); }
+  string_view decrypt(string_view message, pmr::string &out) const { return apply(decrypt_table, message, out); }
+};
+
+const string alphabet {"[ abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"};
+const string key {" [XZNLWEBGJHQDYVTKFUOMPCIASRxznlwebgjhqdyvtkfuompciasr"};
+
+// one request the way the programs above do it
+size_t old_request(const string &s2, const string &s5, const string &message) {
+  string s3 = s5 + " and " + s2 + " juice";
+  string encrypted_message {};
+  for (char c : message) {
+    size_t position = alphabet.find(c);
+    if (position != string::npos)
+      encrypted_message += key.at(position);
+    else
+      encrypted_message += c;
+  }
+  string decrypted_message {};
+  for (char c : encrypted_message) {
+    size_t position = key.find(c);
+    if (position != string::npos)
+      decrypted_message += alphabet.at(position);
+    else
+      decrypted_message += c;
+  }
+  return s3.size() + decrypted_message.size();
+}
+
+// the same request with concat, the table cipher and an arena that lives as long as the request
+size_t new_request(const string &s2, const string &s5, const string &message, const Cipher &cipher) {
+  alignas(max_align_t) char buffer[16384];
+  pmr::monotonic_buffer_resource arena {buffer, sizeof buffer};   // more from the heap only if 16 KB isn't enough
+  pmr::string s3 = pmr_concat(&arena, s5, " and ", s2, " juice");
+  pmr::string encrypted_message {&arena}, decrypted_message {&arena};
+  cipher.encrypt(message, encrypted_message);
+  cipher.decrypt(encrypted_message, decrypted_message);
+  return s3.size() + decrypted_message.size();
+}                                         // the whole arena is gone here, no frees one by one
+
+template <typename Function>
+double time_seconds(Function function) {
+  auto start = chrono::steady_clock::now();
+  function();
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+void benchmark(size_t requests) {
+  string s2 {"Banana"}, s5 {"Apple"};
+  string message;
+  for (size_t i {0}; i < 40; ++i)
+    message += "Meet me at the old oak tree at midnight! ";   // about 1,600 characters
+  Cipher cipher {alphabet, key};
+
+  size_t old_total {0}, new_total {0};
+  size_t before = allocation_count;
+  double old_time = time_seconds([&]() {
+    for (size_t i {0}; i < requests; ++i)
+      old_total += old_request(s2, s5, message);
+  });
+  size_t old_allocations = allocation_count - before;
+  before = allocation_count;
+  double new_time = time_seconds([&]() {
+    for (size_t i {0}; i < requests; ++i)
+      new_total += new_request(s2, s5, message, cipher);
+  });
+  size_t new_allocations = allocation_count - before;
+
+  cout << requests << " requests (concatenation, encrypt and decrypt " << message.size() << " characters)" << fixed << setprecision(2) << endl;
+  cout << "+ and +=          : " << setw(8) << old_time << " s, " << setw(6) << static_cast<double>(old_allocations) / requests << " allocations per request" << endl;
+  cout << "concat and arena  : " << setw(8) << new_time << " s, " << setw(6) << static_cast<double>(new_allocations) / requests << " allocations per request  ("
+       << old_time / new_time << "x)" << endl;
+  if (old_total != new_total)
+    cout << "the results differ!" << endl;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 1 && string_view {argv[1]} == "--benchmark") {
+    benchmark(argc > 2 ? stoul(argv[2]) : 1'000'000);
+    return 0;
+  }
+
+  alignas(max_align_t) char buffer[4096];
+  pmr::monotonic_buffer_resource arena {buffer, sizeof buffer};
+  string s2 {"Banana"}, s5 {"Apple"};
+  size_t before = allocation_count;
+  pmr::string s3 = pmr_concat(&arena, s5, " and ", s2, " juice");
+  cout << "s3 is now: " << s3 << " (" << allocation_count - before << " heap allocations)" << endl;
+  before = allocation_count;
+  string s4 = concat("nice ", "cold ", s5, ' ', "juice");   // "nice " + " cold " doesn't even compile, concat doesn't mind
+  cout << "s4 is now: " << s4 << " (" << allocation_count - before << " heap allocation)" << endl;
+
+  string secret_message {};
+  cout << "Enter your secret message : ";
+  getline(cin, secret_message);
+  Cipher cipher {alphabet, key};
+  pmr::string encrypted_message {&arena}, decrypted_message {&arena};
+  cout << "\nEncrypted message: " << cipher.encrypt(secret_message, encrypted_message) << endl;
+  cout << "\nDecrypted message: " << cipher.decrypt(encrypted_message, decrypted_message) << endl;
+  cout << endl;
+  return 0;
+}
+
 /*
 Write a C++ program that displays a Letter Pyramid from a user-provided std::string.
 Prompt the user to enter a std::string and then from that string display a Letter Pyramid as follows:
@@ -4142,7 +8796,412 @@ int main() {
     cout << random_number << endl;
   }
 
-  cout  << endl;
+  cout  << endl;
+  return 0;
+}
+
+// built-in function / Random Numbers - xoshiro256** and Lemire's bounded integers
+// rand() % max + min is fine for rolling one die, but it has three problems. It's biased: RAND_MAX + 1 is usually not a multiple of max, so some faces come up slightly more often than others. It's serialized: rand() keeps its state in a hidden global, so threads either fight over it or the results are not even guaranteed. And it's slow. Below is a small random number module. The generator is xoshiro256** (by Blackman and Vigna): 256 bits of state, a few shifts, rotates and xors per number, and a jump() function that moves the state 2^128 steps ahead, so every thread gets its own stream that never overlaps the others. Numbers in [min, max] come from Lemire's method: multiply a 64-bit random number by the size of the range and keep the high 64 bits; only in the rare case the low bits fall in the biased zone do we draw again. No division in the common case and no bias. For filling big arrays, Xoshiro256Lanes runs 8 independent generators side by side in arrays (structure of arrays), so the same shift/xor on 8 lanes becomes a couple of SIMD instructions - compile with -O3 -march=native and the compiler vectorizes that loop for us.
+#include <iostream>
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <chrono>
+using namespace std;
+
+inline uint64_t rotl(uint64_t x, int k) {
+  return (x << k) | (x >> (64 - k));
+}
+
+// splitmix64 - turns one 64-bit seed into well mixed state words
+inline uint64_t splitmix64(uint64_t &seed) {
+  uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+class Xoshiro256 {
+  uint64_t s[4];
+public:
+  explicit Xoshiro256(uint64_t seed) {
+    for (auto &word: s)
+      word = splitmix64(seed);
+  }
+  uint64_t next() {
+    const uint64_t result = rotl(s[1] * 5, 7) * 9;
+    const uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+  }
+  // equivalent to 2^128 calls to next() - use it to hand out non-overlapping streams
+  void jump() {
+    static const uint64_t JUMP[] {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+    uint64_t t[4] {};
+    for (uint64_t jump_word: JUMP)
+      for (int b {0}; b < 64; ++b) {
+        if (jump_word & (1ULL << b))
+          for (int i {0}; i < 4; ++i)
+            t[i] ^= s[i];
+        next();
+      }
+    for (int i {0}; i < 4; ++i)
+      s[i] = t[i];
+  }
+  // stream number k: the seed state jumped k times
+  Xoshiro256 stream(unsigned k) const {
+    Xoshiro256 copy {*this};
+    for (unsigned i {0}; i < k; ++i)
+      copy.jump();
+    return copy;
+  }
+  // Lemire's method: an unbiased number in [0, range)
+  uint64_t bounded(uint64_t range) {
+    __uint128_t m = static_cast<__uint128_t>(next()) * range;
+    uint64_t low = static_cast<uint64_t>(m);
+    if (low < range) {                    // maybe in the biased zone - only then pay for the division
+      uint64_t threshold = -range % range;
+      while (low < threshold) {
+        m = static_cast<__uint128_t>(next()) * range;
+        low = static_cast<uint64_t>(m);
+      }
+    }
+    return static_cast<uint64_t>(m >> 64);
+  }
+  uint64_t state_word(int i) const { return s[i]; }
+  // an unbiased number in [min, max] - the replacement for rand() % max + min
+  int64_t uniform(int64_t min, int64_t max) {
+    return min + static_cast<int64_t>(bounded(static_cast<uint64_t>(max - min) + 1));
+  }
+};
+
+// Xoshiro256Lanes - LANES generators kept as structure of arrays so the bulk loops vectorize
+class Xoshiro256Lanes {
+  static constexpr int LANES {8};
+  uint64_t s0[LANES], s1[LANES], s2[LANES], s3[LANES];
+public:
+  explicit Xoshiro256Lanes(Xoshiro256 base) {
+    for (int lane {0}; lane < LANES; ++lane) { // each lane is its own jumped stream
+      s0[lane] = base.state_word(0);
+      s1[lane] = base.state_word(1);
+      s2[lane] = base.state_word(2);
+      s3[lane] = base.state_word(3);
+      base.jump();
+    }
+  }
+  // one xoshiro256** step on every lane, one lane per SIMD slot
+  void step(uint64_t *out) {
+    for (int lane {0}; lane < LANES; ++lane) {
+      out[lane] = rotl(s1[lane] * 5, 7) * 9;
+      const uint64_t t = s1[lane] << 17;
+      s2[lane] ^= s0[lane];
+      s3[lane] ^= s1[lane];
+      s1[lane] ^= s2[lane];
+      s0[lane] ^= s3[lane];
+      s2[lane] ^= t;
+      s3[lane] = rotl(s3[lane], 45);
+    }
+  }
+  void fill(uint64_t *out, size_t count) {
+    size_t i {0};
+    for (; i + LANES <= count; i += LANES)
+      step(out + i);
+    if (i < count) {                          // tail: one more round, keep what we need
+      uint64_t extra[LANES];
+      step(extra);
+      for (size_t lane {0}; lane < count - i; ++lane)
+        out[i + lane] = extra[lane];
+    }
+  }
+  // count unbiased numbers in [min, max] (range up to 2^32) - Lemire with 32x32->64 multiplies, which vectorize
+  void fill_uniform(int32_t *out, size_t count, int32_t min, int32_t max) {
+    const uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(max) - min) + 1;
+    const uint32_t threshold = static_cast<uint32_t>((uint64_t{1} << 32) % range);
+    vector<uint64_t> raw((count + 1) / 2);
+    fill(raw.data(), raw.size());
+    size_t rejected {0};
+    for (size_t i {0}; i < count; ++i) {      // every 64-bit number gives two 32-bit numbers
+      uint32_t r = static_cast<uint32_t>(raw[i / 2] >> ((i & 1) * 32));
+      uint64_t m = r * range;
+      out[i] = min + static_cast<int32_t>(m >> 32);
+      rejected += static_cast<uint32_t>(m) < threshold;
+    }
+    if (rejected == 0)                        // the usual case for small ranges like a die
+      return;
+    for (size_t i {0}; i < count; ++i) {      // redo only the biased draws
+      uint32_t r = static_cast<uint32_t>(raw[i / 2] >> ((i & 1) * 32));
+      uint64_t m = r * range;
+      while (static_cast<uint32_t>(m) < threshold) {
+        uint64_t next;
+        fill(&next, 1);
+        m = static_cast<uint32_t>(next) * range;
+      }
+      out[i] = min + static_cast<int32_t>(m >> 32);
+    }
+  }
+};
+
+int main() {
+  size_t count {10}; // number of random numbers to generate
+  int min {1}; // lower bound (inclusive)
+  int max {6}; // upper bound (inclusive)
+  
+  // seeded once from the clock like before - pass a fixed number instead to get the same sequence every run
+  Xoshiro256 generator {static_cast<uint64_t>(chrono::steady_clock::now().time_since_epoch().count())};
+  for (size_t i{1}; i<=count; ++i)
+    cout << generator.uniform(min, max) << " ";   // generate a random number [min, max] with no bias
+  cout << endl;
+
+  // Monte Carlo on all cores: every thread gets its own jumped stream, so there is no shared state and no locks
+  unsigned threads = thread::hardware_concurrency();
+  if (threads == 0)
+    threads = 1;
+  const size_t batch {1 << 16};
+  const size_t batches_per_thread {800};
+  vector<uint64_t> totals(threads);
+  vector<thread> workers;
+  auto start = chrono::steady_clock::now();
+  for (unsigned t {0}; t < threads; ++t)
+    workers.emplace_back([&, t]() {
+      Xoshiro256Lanes lanes {generator.stream(8 * (t + 1))}; // a Xoshiro256Lanes uses 8 consecutive streams
+      vector<int32_t> rolls(batch);
+      uint64_t total {0};
+      for (size_t b {0}; b < batches_per_thread; ++b) {
+        lanes.fill_uniform(rolls.data(), rolls.size(), min, max);
+        for (int32_t roll: rolls)
+          total += roll;
+      }
+      totals[t] = total;
+    });
+  for (auto &worker: workers)
+    worker.join();
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  
+  uint64_t total {0};
+  for (auto thread_total: totals)
+    total += thread_total;
+  size_t rolls = threads * batches_per_thread * batch;
+  cout << "Average of " << rolls << " rolls: " << static_cast<double>(total) / rolls << " (expect 3.5)" << endl;
+  cout << rolls / seconds / 1e6 << " million rolls per second on " << threads << " thread(s)" << endl;
+  return 0;
+}
+
+// Random Numbers - a reproducible dice simulation harness
+// Seeding from time(nullptr) means no two runs are the same, which is exactly what we don't want when a simulation gives a strange answer and we need to run it again. And printing every value with cout << random_number << endl flushes the stream once per number. This harness takes an explicit seed and stream id on the command line, so the same command always gives the same result. The trials are cut into fixed blocks of block_size rolls, and block k always uses substream k (the generator jumped k times). Each thread takes a contiguous range of blocks, so the answer doesn't depend on how many threads we happened to use. Instead of printing every roll we count them into a histogram. With --raw the rolls are printed, but through a buffered writer that formats with to_chars into a big buffer and writes it out in large pieces. The die is user-defined: any faces with any weights.
+// usage: dice_sim <seed> <stream> <trials> [--raw] [face:weight ...]   e.g. dice_sim 42 0 100000000 1:1 2:1 3:1 4:1 5:1 6:3
+#include <iostream>
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <thread>
+#include <charconv>
+#include <algorithm>
+#include <iomanip>
+using namespace std;
+
+// Xoshiro256 from the random number module above (only the parts we need)
+inline uint64_t rotl(uint64_t x, int k) {
+  return (x << k) | (x >> (64 - k));
+}
+class Xoshiro256 {
+  uint64_t s[4];
+  void apply_jump(const uint64_t (&polynomial)[4]) {
+    uint64_t t[4] {};
+    for (uint64_t jump_word: polynomial)
+      for (int b {0}; b < 64; ++b) {
+        if (jump_word & (1ULL << b))
+          for (int i {0}; i < 4; ++i)
+            t[i] ^= s[i];
+        next();
+      }
+    for (int i {0}; i < 4; ++i)
+      s[i] = t[i];
+  }
+public:
+  explicit Xoshiro256(uint64_t seed) {
+    for (auto &word: s) {               // splitmix64
+      uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      word = z ^ (z >> 31);
+    }
+  }
+  uint64_t next() {
+    const uint64_t result = rotl(s[1] * 5, 7) * 9;
+    const uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+  }
+  void jump() {        // 2^128 steps - one substream (block) to the next
+    static const uint64_t JUMP[4] {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+    apply_jump(JUMP);
+  }
+  void long_jump() {   // 2^192 steps - one stream id to the next, room for 2^64 blocks per stream
+    static const uint64_t LONG_JUMP[4] {0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL, 0x77710069854ee241ULL, 0x39109bb02acbe635ULL};
+    apply_jump(LONG_JUMP);
+  }
+  uint64_t bounded(uint64_t range) {    // Lemire's method
+    __uint128_t m = static_cast<__uint128_t>(next()) * range;
+    uint64_t low = static_cast<uint64_t>(m);
+    if (low < range) {
+      uint64_t threshold = -range % range;
+      while (low < threshold) {
+        m = static_cast<__uint128_t>(next()) * range;
+        low = static_cast<uint64_t>(m);
+      }
+    }
+    return static_cast<uint64_t>(m >> 64);
+  }
+};
+
+// a die with any faces and any (integer) weights
+struct Face {
+  int value;
+  uint64_t weight;
+};
+class Die {
+  vector<int> values;
+  vector<uint64_t> cumulative;          // running total of the weights
+public:
+  explicit Die(const vector<Face> &faces) {
+    uint64_t total {0};
+    for (const auto &face: faces) {
+      total += face.weight;
+      values.push_back(face.value);
+      cumulative.push_back(total);
+    }
+  }
+  size_t faces() const { return values.size(); }
+  int value(size_t face) const { return values[face]; }
+  // index of the face that came up
+  size_t roll(Xoshiro256 &generator) const {
+    uint64_t r = generator.bounded(cumulative.back());
+    return upper_bound(cumulative.begin(), cumulative.end(), r) - cumulative.begin();
+  }
+};
+
+// collects text in a big buffer and writes it out in large pieces instead of once per line
+class BufferedWriter {
+  vector<char> buffer;
+  size_t used {0};
+  FILE *out;
+public:
+  explicit BufferedWriter(FILE *out, size_t capacity = 1 << 20) : buffer(capacity), out{out} {}
+  ~BufferedWriter() { flush(); }
+  void flush() {
+    fwrite(buffer.data(), 1, used, out);
+    used = 0;
+  }
+  void write_line(int value) {
+    if (buffer.size() - used < 16)      // an int and a newline always fit in 16 chars
+      flush();
+    auto result = to_chars(buffer.data() + used, buffer.data() + buffer.size(), value);
+    *result.ptr = '\n';
+    used = result.ptr + 1 - buffer.data();
+  }
+};
+
+const uint64_t block_size {1 << 16};    // rolls per substream
+
+// the generator for block number `first` of the stream, ready to be stepped with jump() to the following blocks
+Xoshiro256 block_generator(uint64_t seed, uint64_t stream, uint64_t first) {
+  Xoshiro256 generator {seed};
+  for (uint64_t i {0}; i < stream; ++i)
+    generator.long_jump();
+  for (uint64_t i {0}; i < first; ++i)
+    generator.jump();
+  return generator;
+}
+
+// roll blocks [first, last) - the rolls of block k are rolls [k * block_size, (k+1) * block_size) of the whole run
+template <typename Visit>
+void roll_blocks(const Die &die, uint64_t seed, uint64_t stream, uint64_t trials, uint64_t first, uint64_t last, Visit visit) {
+  Xoshiro256 next_block = block_generator(seed, stream, first);
+  for (uint64_t block {first}; block < last; ++block) {
+    Xoshiro256 generator = next_block;
+    next_block.jump();
+    uint64_t end = min(trials, (block + 1) * block_size);
+    for (uint64_t trial {block * block_size}; trial < end; ++trial)
+      visit(die.roll(generator));
+  }
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 4) {
+    cerr << "usage: " << argv[0] << " <seed> <stream> <trials> [--raw] [face:weight ...]" << endl;
+    return 1;
+  }
+  uint64_t seed = stoull(argv[1]);
+  uint64_t stream = stoull(argv[2]);
+  uint64_t trials = stoull(argv[3]);
+  bool raw {false};
+  vector<Face> faces;
+  for (int i {4}; i < argc; ++i) {
+    string arg {argv[i]};
+    if (arg == "--raw") {
+      raw = true;
+      continue;
+    }
+    size_t colon = arg.find(':');
+    if (colon == string::npos) {
+      faces.push_back({stoi(arg), 1});
+    } else {
+      faces.push_back({stoi(arg.substr(0, colon)), stoull(arg.substr(colon + 1))});
+    }
+  }
+  if (faces.empty())                      // a regular die [1, 6]
+    for (int value {1}; value <= 6; ++value)
+      faces.push_back({value, 1});
+  uint64_t total_weight {0};
+  for (const auto &face: faces)
+    total_weight += face.weight;
+  if (total_weight == 0) {
+    cerr << "the die needs at least one face with a weight above 0" << endl;
+    return 1;
+  }
+  Die die {faces};
+  uint64_t blocks = (trials + block_size - 1) / block_size;
+
+  if (raw) {
+    // same blocks, walked in order on one thread so the output order never changes
+    BufferedWriter writer {stdout};
+    roll_blocks(die, seed, stream, trials, 0, blocks, [&](size_t face) { writer.write_line(die.value(face)); });
+    return 0;
+  }
+
+  unsigned threads = thread::hardware_concurrency();
+  if (threads == 0)
+    threads = 1;
+  vector<vector<uint64_t>> histograms(threads, vector<uint64_t>(die.faces()));
+  vector<thread> workers;
+  for (unsigned t {0}; t < threads; ++t)
+    workers.emplace_back([&, t]() {
+      uint64_t first = blocks * t / threads;
+      uint64_t last = blocks * (t + 1) / threads;
+      vector<uint64_t> &histogram = histograms[t];   // each thread counts into its own histogram, no sharing
+      roll_blocks(die, seed, stream, trials, first, last, [&](size_t face) { ++histogram[face]; });
+    });
+  for (auto &worker: workers)
+    worker.join();
+
+  cout << "seed " << seed << ", stream " << stream << ", " << trials << " trials" << endl;
+  for (size_t face {0}; face < die.faces(); ++face) {
+    uint64_t count {0};
+    for (const auto &histogram: histograms)
+      count += histogram[face];
+    cout << setw(6) << die.value(face) << ": " << setw(12) << count << "  " << fixed << setprecision(4) << 100.0 * count / max<uint64_t>(trials, 1) << "%" << endl;
+  }
   return 0;
 }
 /*
@@ -4165,6 +9224,120 @@ int individual_bill_2 = round(individual_bill);
 double individual_bill_3 = ceil(individual_bill*100)/100;
 cout << "The individual bill at location 1 will be $" << individual_bill_1 << "\n" << "The individual bill at location 2 will be $" << individual_bill_2 << "\n" << "The individual bill at location 3 will be $" << individual_bill_3;
 
+// POS - splitting bills with named rounding policies
+// The exercise uses floor, round and ceil on a double bill. That works for one bill, but doubles can't hold most cent amounts exactly, and a restaurant chain wants to know exactly how many cents each location keeps or gives away when the bill doesn't split evenly. Here every bill is in whole cents and each location has a named rounding policy: a unit (a cent or a dollar) and a mode (down, nearest with halves up, up, or banker's rounding, where an exact half goes to the even number so the roundings don't all push the same way). The share is worked out with integer math on the exact fraction bill / guests, so there is no floating point error at all and every run gives identical results. The leftover is what the location keeps (positive) or gives away (negative): bill - share * guests. split_exactly() reconciles a bill to the cent by giving the leftover cents to the first guests. The batch version splits millions of bills stored as arrays; the division is done in double precision (which vectorizes) and then corrected by one integer step, so the answer is still exact.
+#include <iostream>
+#include <iomanip>
+#include <cstdint>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+using namespace std;
+
+enum class Rounding {down, nearest, up, bankers};
+
+struct RoundingPolicy {
+  string name;
+  int64_t unit;                         // in cents: 1 = to the cent, 100 = to the dollar
+  Rounding mode;
+};
+
+const vector<RoundingPolicy> policies {
+  {"floor-to-dollar", 100, Rounding::down},     // location 1
+  {"nearest-dollar", 100, Rounding::nearest},   // location 2
+  {"ceil-to-cent", 1, Rounding::up},            // location 3
+  {"bankers-to-cent", 1, Rounding::bankers},
+};
+
+// bill / guests rounded to the policy's unit - everything is whole cents, bill >= 0, guests > 0
+int64_t split(int64_t bill, int64_t guests, const RoundingPolicy &policy) {
+  int64_t divisor = guests * policy.unit;
+  int64_t quotient = bill / divisor;
+  int64_t remainder = bill % divisor;
+  switch (policy.mode) {
+    case Rounding::down:
+      break;
+    case Rounding::nearest:
+      quotient += 2 * remainder >= divisor;
+      break;
+    case Rounding::up:
+      quotient += remainder > 0;
+      break;
+    case Rounding::bankers:
+      quotient += 2 * remainder > divisor || (2 * remainder == divisor && quotient % 2 == 1);
+      break;
+  }
+  return quotient * policy.unit;
+}
+
+// shares that add up to exactly the bill: everyone pays bill / guests rounded down, the first (bill % guests) guests pay one cent more
+vector<int64_t> split_exactly(int64_t bill, int64_t guests) {
+  vector<int64_t> shares(guests, bill / guests);
+  for (int64_t i {0}; i < bill % guests; ++i)
+    ++shares[i];
+  return shares;
+}
+
+// the batch version: share[i] and leftover[i] for every bill, all with the same policy
+void split_batch(const int64_t *bill, const int32_t *guests, size_t count, const RoundingPolicy &policy, int64_t *share, int64_t *leftover) {
+  const int64_t unit = policy.unit;
+  const Rounding mode = policy.mode;
+  for (size_t i {0}; i < count; ++i) {  // no branches on the data: vectorizes with -O3 -march=native
+    int64_t divisor = guests[i] * unit;
+    int64_t quotient = static_cast<int64_t>(static_cast<double>(bill[i]) / static_cast<double>(divisor));
+    quotient -= quotient * divisor > bill[i];               // the double quotient can be one off, fix it exactly
+    quotient += (quotient + 1) * divisor <= bill[i];
+    int64_t remainder = bill[i] - quotient * divisor;
+    int64_t round_up = (mode == Rounding::up) & (remainder > 0);
+    round_up |= (mode == Rounding::nearest) & (2 * remainder >= divisor);
+    round_up |= (mode == Rounding::bankers) & ((2 * remainder > divisor) | ((2 * remainder == divisor) & (quotient & 1)));
+    share[i] = (quotient + round_up) * unit;
+    leftover[i] = bill[i] - share[i] * guests[i];
+  }
+}
+
+int main() {
+  // the exercise: $102.78 split between 5 guests
+  int64_t bill_total {10278};           // cents
+  int number_of_guests {5};
+  cout << fixed << setprecision(2);
+  for (const auto &policy: policies) {
+    int64_t individual_bill = split(bill_total, number_of_guests, policy);
+    int64_t leftover = bill_total - individual_bill * number_of_guests;
+    cout << setw(16) << left << policy.name << " $" << individual_bill / 100.0 << " each, the location " << (leftover >= 0 ? "keeps" : "gives away") << " $" << abs(leftover) / 100.0 << endl;
+  }
+  cout << "split exactly    :";
+  for (int64_t share: split_exactly(bill_total, number_of_guests))
+    cout << " $" << share / 100.0;
+  cout << endl << endl;
+
+  // a batch of 10 million bills
+  const size_t count {10'000'000};
+  vector<int64_t> bills(count), shares(count), leftovers(count);
+  vector<int32_t> guests(count);
+  uint64_t state {2024};
+  for (size_t i {0}; i < count; ++i) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    bills[i] = static_cast<int64_t>((state >> 24) % 500'000);   // up to $5000
+    guests[i] = 1 + static_cast<int32_t>((state >> 8) % 12);
+  }
+  for (const auto &policy: policies) {
+    auto start = chrono::steady_clock::now();
+    split_batch(bills.data(), guests.data(), count, policy, shares.data(), leftovers.data());
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    int64_t reconciled {0};             // what the location keeps (or gives away) over the whole batch
+    for (size_t i {0}; i < count; ++i)
+      reconciled += leftovers[i];
+    for (size_t i {0}; i < count; i += count / 1000)   // spot check the batch against the one-bill version
+      if (shares[i] != split(bills[i], guests[i], policy))
+        cout << "mismatch at bill " << i << endl;
+    cout << setw(16) << left << policy.name << " leftover over " << count << " bills: $" << reconciled / 100.0
+         << " (" << count / seconds / 1e6 << " million bills/s)" << endl;
+  }
+  return 0;
+}
+
 // user-defined function: Function definitions have four main parts. We'll look at the syntax of functions in the next slide. But for now, let's look at what these parts are. The function has to have a name. The name of the function follows the same rules we use for naming variables. Function names should be meaningful and provide the reader the intent of the function. For example, a function called func1 and another function called func2 may be okay when teaching functions in my slides. But what if I read some production code with function names like that. I'd have no idea what these functions are doing based on those names. Functions perform operations. So usually, you see function names as verb or verb phrases. This isn't always the case, but it's a good habit to get into. The second part of a function is the parameter list. This is the list of variables that the function expects from you when you call it. For example, if you're calling a function that adds 2 integers, then the 2 integers are in the parameter list. Sometimes functions don't need any parameters at all. Suppose I have a function that simply displays hello or a function that returns a system time to me. These functions can be called with an empty parameter list. All functions have the ability to return information to the caller of the function. In order to return information, we must specify the type of that information. So I might return a Boolean or an integer or a double or a string. Also it's possible that a function returns nothing. For example, if I need a function to just display hello, I really don't expect anything back from that function. In this case, we say that the return type is the keyword void. Finally, functions have bodies. These are statements to be executed and they're enclosed in curly braces. You've already seen an example of this in the main function. So as you can see, a function definition is pretty logical, the name of the function, what it expects, what it returns and what it does. Let's look at the syntax of a function definition.
 int function_name() { // this function expects no parameters.
   statements;
@@ -4461,6 +9634,209 @@ double fahrenheit_to_kelvin(double temperature) {
   return round(((temperature - 32)*5)/9 + 273);
 }
 
+// Converting Temperatures - a sensor data pipeline
+// temperature_conversion converts one reading per call, and the range-based for loop that averages temperatures is a second pass over the data. A sensor network sends billions of readings a day, so this pipeline does everything in one pass over large chunks. Every conversion between Fahrenheit, Celsius and Kelvin is out = scale * in + offset (F to C is scale 5/9 and offset -32 * 5/9, C to K is scale 1 and offset 273.15), so one loop handles all of them, and in the same loop we add the converted value to the total and compare it against the minimum and maximum. The loop keeps 8 separate totals, minimums and maximums (one per SIMD lane) and combines them at the end of the chunk: with a single total every addition would have to wait for the previous one, with 8 the compiler can use full SIMD registers. The input file is read one chunk of 1M readings at a time (raw doubles, or one number per line with --text), so the memory use stays the same for a file of any size and the speed is close to how fast the disk and memory can deliver the data. Note that this uses 273.15 for Kelvin, not the rounded 273 from the exercise.
+// usage: telemetry <readings file> <from F|C|K> <to F|C|K> [--text] [--out converted.bin]
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <limits>
+#include <charconv>
+#include <chrono>
+using namespace std;
+
+struct Conversion {
+  double scale;
+  double offset;
+};
+
+// from Celsius to the unit, and back
+Conversion from_celsius(char unit) {
+  switch (unit) {
+    case 'F': return {9.0 / 5.0, 32.0};
+    case 'K': return {1.0, 273.15};
+    default:  return {1.0, 0.0};
+  }
+}
+bool is_unit(const char *text) {
+  return (text[0] == 'F' || text[0] == 'C' || text[0] == 'K') && text[1] == '\0';
+}
+Conversion conversion(char from, char to) {
+  Conversion to_c {1.0 / from_celsius(from).scale, -from_celsius(from).offset / from_celsius(from).scale};
+  Conversion from_c = from_celsius(to);
+  return {from_c.scale * to_c.scale, from_c.scale * to_c.offset + from_c.offset};
+}
+
+struct Statistics {
+  size_t count {0};
+  double total {0};
+  double minimum {numeric_limits<double>::infinity()};
+  double maximum {-numeric_limits<double>::infinity()};
+  double mean() const { return count == 0 ? 0 : total / count; }
+};
+
+// converts in place and adds the chunk to the statistics - one pass, 8 lanes
+void convert_chunk(double *readings, size_t count, Conversion conversion, Statistics &stats) {
+  const int LANES {8};
+  double total[LANES] {}, minimum[LANES], maximum[LANES];
+  for (int lane {0}; lane < LANES; ++lane) {
+    minimum[lane] = numeric_limits<double>::infinity();
+    maximum[lane] = -numeric_limits<double>::infinity();
+  }
+  size_t i {0};
+  for (; i + LANES <= count; i += LANES)
+    for (int lane {0}; lane < LANES; ++lane) {
+      double converted = conversion.scale * readings[i + lane] + conversion.offset;
+      readings[i + lane] = converted;
+      total[lane] += converted;
+      minimum[lane] = converted < minimum[lane] ? converted : minimum[lane];
+      maximum[lane] = converted > maximum[lane] ? converted : maximum[lane];
+    }
+  for (int lane {0}; i < count; ++i, lane = (lane + 1) % LANES) {   // the last few readings
+    double converted = conversion.scale * readings[i] + conversion.offset;
+    readings[i] = converted;
+    total[lane] += converted;
+    minimum[lane] = converted < minimum[lane] ? converted : minimum[lane];
+    maximum[lane] = converted > maximum[lane] ? converted : maximum[lane];
+  }
+  for (int lane {0}; lane < LANES; ++lane) {
+    stats.total += total[lane];
+    stats.minimum = minimum[lane] < stats.minimum ? minimum[lane] : stats.minimum;
+    stats.maximum = maximum[lane] > stats.maximum ? maximum[lane] : stats.maximum;
+  }
+  stats.count += count;
+}
+
+inline bool is_separator(char c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == ',';
+}
+
+// reads up to max readings - raw doubles, or text numbers separated by whitespace or commas; a text token that isn't a number is skipped and counted in malformed
+class ReadingReader {
+  FILE *in;
+  bool text;
+  vector<char> block;
+  size_t used {0}, position {0};
+  bool at_end {false};
+  bool skipping {false};                  // in the middle of a token too long for the block
+  // keeps the unread part, moved to the front, and reads more after it
+  void refill() {
+    copy(block.begin() + position, block.begin() + used, block.begin());
+    used -= position;
+    position = 0;
+    used += fread(block.data() + used, 1, block.size() - used, in);
+    at_end = feof(in) || ferror(in);      // not "read nothing": a full block reads nothing too
+  }
+public:
+  size_t malformed {0};
+  ReadingReader(FILE *in, bool text) : in{in}, text{text}, block(text ? 1 << 22 : 0) {}
+  bool failed() const { return ferror(in) != 0; }
+  size_t read(double *readings, size_t max) {
+    if (!text)
+      return fread(readings, sizeof(double), max, in);
+    size_t count {0};
+    while (count < max) {
+      if (skipping) {                     // drop the rest of the long token
+        while (position < used && !is_separator(block[position]))
+          ++position;
+        if (position == used && !at_end) {
+          refill();
+          continue;
+        }
+        skipping = false;
+      }
+      while (position < used && is_separator(block[position]))
+        ++position;
+      size_t end = position;
+      while (end < used && !is_separator(block[end]))
+        ++end;
+      if (end == used && !at_end) {       // the number might continue in the next block
+        if (position == 0 && used == block.size()) {
+          ++malformed;                    // one token fills the whole block - no number is that long
+          position = used;
+          skipping = true;
+        }
+        refill();
+        continue;
+      }
+      if (end == position)
+        break;                            // nothing left
+      auto [ptr, ec] = from_chars(block.data() + position, block.data() + end, readings[count]);
+      if (ec == errc() && ptr == block.data() + end)
+        ++count;
+      else
+        ++malformed;                      // "12.5x", "abc", or out of range for a double
+      position = end;
+    }
+    return count;
+  }
+};
+
+int main(int argc, char *argv[]) {
+  if (argc < 4) {
+    cerr << "usage: " << argv[0] << " <readings file> <from F|C|K> <to F|C|K> [--text] [--out converted.bin]" << endl;
+    return 1;
+  }
+  if (!is_unit(argv[2]) || !is_unit(argv[3])) {
+    cerr << "Unknown unit - use F, C or K" << endl;
+    return 1;
+  }
+  char from = argv[2][0], to = argv[3][0];
+  bool text {false};
+  string out_name;
+  for (int i {4}; i < argc; ++i) {
+    string arg {argv[i]};
+    if (arg == "--text")
+      text = true;
+    else if (arg == "--out" && i + 1 < argc)
+      out_name = argv[++i];
+  }
+  FILE *in = fopen(argv[1], "rb");
+  if (!in) {
+    cerr << "Error opening file " << argv[1] << endl;
+    return 1;
+  }
+  FILE *out = out_name.empty() ? nullptr : fopen(out_name.c_str(), "wb");
+  if (!out_name.empty() && !out) {
+    cerr << "Error opening file " << out_name << endl;
+    fclose(in);
+    return 1;
+  }
+
+  Conversion convert = conversion(from, to);
+  ReadingReader reader {in, text};
+  vector<double> chunk(1 << 20);
+  Statistics stats;
+  auto start = chrono::steady_clock::now();
+  while (size_t count = reader.read(chunk.data(), chunk.size())) {
+    convert_chunk(chunk.data(), count, convert, stats);
+    if (out)
+      fwrite(chunk.data(), sizeof(double), count, out);
+  }
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  bool read_failed = reader.failed();
+  fclose(in);
+  if (out)
+    fclose(out);
+  if (read_failed) {
+    cerr << "Error reading file " << argv[1] << endl;
+    return 1;
+  }
+
+  cout << fixed << setprecision(2);
+  cout << stats.count << " readings converted from " << from << " to " << to << endl;
+  cout << "Average temperature is " << stats.mean() << endl;
+  cout << "Minimum temperature is " << stats.minimum << endl;
+  cout << "Maximum temperature is " << stats.maximum << endl;
+  cout << stats.count * sizeof(double) / seconds / 1e9 << " GB/s" << endl;
+  if (reader.malformed != 0)
+    cerr << reader.malformed << " malformed reading(s) skipped" << endl;
+  return 0;
+}
+
 // default arguments:  when we call a function, we must provide all the arguments that, that function requires, and they must be in the right order and of the right type. But sometimes when we call functions some of the argument values that we pass in tend to be the same values most of the time. For example, if we have a function that calculates the cost of an item, we can provide the function with the base cost of the item and the sales tax rate. Suppose that 98% of our customers live in a region where the tax rate is 6%, that means that we have to provide the tax rate in every function call even though it will almost always be 6%. C++ allows us to provide default values for arguments. So in the case of the sales tax, if we omit the argument from the function call, then the c++ compiler will automatically replace it with the default value of 6%. However, if we have a customer whose sales tax rate is 8%, then we can provide it explicitly and override the default value. As we'll see in the next few slides, we can add default arguments to the function prototype or the function definition but not both. But best practice is to do it in the function prototype. Default arguments must appear at the tail end of the parameter list. We can also have multiple default arguments.
 // default argument values give us the ability to make our code less verbose and potentially prevent errors by using default values rather than having to supply all of the arguments to the function all the time.
 double calc_cost(double base_cost, double tax_rate = 0.06, double shipping = 3.50);
@@ -4629,6 +10005,327 @@ int main() {
   return 0;
 }
 
+// Function Overloading - one print for everything, formatted at compile time
+// The overload set above needs a new function for every combination of types, sends everything through cout (and endl, which empties the stream's buffer to the screen every time), and print(vector<string> v) copies the whole vector and every string in it just to look at them. Here one variadic template takes any number of arguments of any type, the way printf does but type safe:
+//   static constexpr Format line {"Printing {} and {:>8.2f}\n"};
+//   print<line>(s, 3.14159);
+// The format string is taken apart when the program is compiled. Format's constructor is constexpr, so for a constexpr Format the compiler runs it and stores the result: the literal text between the {} and, for every {}, its options - fill character, < or > to align left or right, width, .precision and the type (d, x for hex, f, e, s; a char is printed as a character unless it gets d or x, then as its code). A mistake in the format, a type that doesn't fit its argument ({:x} on a double, {:.2} on an int, {:d} on a string), or a different number of {} and arguments is a compile error instead of a surprise at run time. print<line> then walks the pieces with if constexpr, so the generated code for an argument is just the formatting it needs. Numbers are written with to_chars into a thread_local buffer (one per thread, no locks and no allocations), which is written out when it's full and when the thread ends, or with flush_output(). Containers are printed by const reference, their elements with the same options and a space between them. {{ and }} print { and }. Run it with --benchmark [lines] > /dev/null to compare with the overload set (the times go to the error output).
+#include <iostream>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <charconv>
+#include <type_traits>
+#include <utility>
+#include <tuple>
+#include <chrono>
+using namespace std;
+
+struct Spec {
+  char fill {' '};
+  char align {'\0'};                      // '<', '>' or the default: numbers right, text left
+  int width {0};
+  int precision {-1};
+  char type {'\0'};
+};
+
+struct Segment {
+  bool is_argument {false};
+  size_t begin {0}, length {0};           // literal text in the format
+  size_t argument {0};
+  Spec spec;
+};
+
+template <size_t N>
+struct Format {
+  static constexpr size_t max_segments {2 * N};
+  char text[N] {};
+  Segment segments[max_segments] {};
+  size_t segment_count {0}, argument_count {0};
+
+  // throwing during constant evaluation stops the compiler with an error pointing here
+  constexpr Format(const char (&format)[N]) {
+    for (size_t i {0}; i < N; ++i)
+      text[i] = format[i];
+    size_t i {0}, literal {0};
+    auto end_literal = [&](size_t end) {
+      if (end > literal)
+        segments[segment_count++] = Segment {false, literal, end - literal, 0, Spec {}};
+    };
+    while (i < N - 1) {
+      char c = format[i];
+      if ((c == '{' || c == '}') && i + 1 < N - 1 && format[i + 1] == c) {   // {{ or }}: keep one
+        end_literal(i + 1);
+        i += 2;
+        literal = i;
+      } else if (c == '}') {
+        throw "a } in a format has to be written as }}";
+      } else if (c == '{') {
+        end_literal(i);
+        Segment argument {true, 0, 0, argument_count++, Spec {}};
+        Spec &spec = argument.spec;
+        ++i;
+        if (format[i] == ':') {
+          ++i;
+          if (format[i] != '}' && (format[i + 1] == '<' || format[i + 1] == '>')) {
+            spec.fill = format[i];
+            spec.align = format[i + 1];
+            i += 2;
+          } else if (format[i] == '<' || format[i] == '>') {
+            spec.align = format[i++];
+          }
+          while (format[i] >= '0' && format[i] <= '9')
+            spec.width = spec.width * 10 + (format[i++] - '0');
+          if (format[i] == '.') {
+            ++i;
+            spec.precision = 0;
+            if (format[i] < '0' || format[i] > '9')
+              throw "a . in a format has to be followed by the precision";
+            while (format[i] >= '0' && format[i] <= '9')
+              spec.precision = spec.precision * 10 + (format[i++] - '0');
+          }
+          if (format[i] == 'd' || format[i] == 'x' || format[i] == 'f' || format[i] == 'e' || format[i] == 's')
+            spec.type = format[i++];
+        }
+        if (format[i] != '}')
+          throw "unknown option in a {} of a format";
+        segments[segment_count++] = argument;
+        literal = ++i;
+      } else {
+        ++i;
+      }
+    }
+    end_literal(N - 1);
+  }
+  constexpr string_view literal(const Segment &s) const { return {text + s.begin, s.length}; }
+};
+
+// one buffer per thread, written out when it's full and when the thread ends
+class OutputBuffer {
+  char data[1 << 16];
+  size_t used {0};
+public:
+  ~OutputBuffer() { flush(); }
+  void flush() {
+    fwrite(data, 1, used, stdout);
+    used = 0;
+  }
+  void write(string_view s) {
+    if (s.size() > sizeof data - used) {
+      flush();
+      if (s.size() > sizeof data) {
+        fwrite(s.data(), 1, s.size(), stdout);
+        return;
+      }
+    }
+    memcpy(data + used, s.data(), s.size());
+    used += s.size();
+  }
+  void fill(char c, size_t count) {
+    while (count > 0) {
+      if (used == sizeof data)
+        flush();
+      size_t n = min(count, sizeof data - used);
+      memset(data + used, c, n);
+      used += n;
+      count -= n;
+    }
+  }
+};
+
+thread_local OutputBuffer output;
+
+void flush_output() {
+  output.flush();
+  fflush(stdout);
+}
+
+template <typename T, typename = void>
+struct is_container : false_type {};
+template <typename T>
+struct is_container<T, void_t<decltype(begin(declval<const T &>())), decltype(end(declval<const T &>()))>>
+  : bool_constant<!is_convertible_v<const T &, string_view>> {};
+
+void write_padded(string_view text, const Spec &spec, bool is_number) {
+  size_t width = static_cast<size_t>(spec.width);
+  if (text.size() >= width) {
+    output.write(text);
+    return;
+  }
+  bool left = spec.align == '<' || (spec.align == '\0' && !is_number);
+  if (!left)
+    output.fill(spec.fill, width - text.size());
+  output.write(text);
+  if (left)
+    output.fill(spec.fill, width - text.size());
+}
+
+template <typename T>
+void write_value(const T &value, const Spec &spec) {
+  if constexpr (is_same_v<T, bool>) {
+    write_padded(value ? "true" : "false", spec, false);
+  } else if constexpr (is_same_v<T, char>) {
+    if (spec.type == 'd' || spec.type == 'x')
+      write_value(static_cast<int>(static_cast<unsigned char>(value)), spec);   // {:x} on 'A' is 41, the character code
+    else
+      write_padded(string_view {&value, 1}, spec, false);
+  } else if constexpr (is_integral_v<T>) {
+    char digits[72];
+    auto result = to_chars(digits, digits + sizeof digits, value, spec.type == 'x' ? 16 : 10);
+    write_padded(string_view {digits, static_cast<size_t>(result.ptr - digits)}, spec, true);
+  } else if constexpr (is_floating_point_v<T>) {
+    char digits[400];                     // enough for 1e308 with all its digits
+    to_chars_result result;
+    if (spec.precision >= 0)
+      result = to_chars(digits, digits + sizeof digits, value, spec.type == 'e' ? chars_format::scientific : chars_format::fixed, spec.precision);
+    else if (spec.type == 'e')
+      result = to_chars(digits, digits + sizeof digits, value, chars_format::scientific);
+    else if (spec.type == 'f')
+      result = to_chars(digits, digits + sizeof digits, value, chars_format::fixed);   // 1e20 is 100000000000000000000, never 1e+20
+    else
+      result = to_chars(digits, digits + sizeof digits, value);   // the shortest text that reads back as the same number
+    write_padded(string_view {digits, static_cast<size_t>(result.ptr - digits)}, spec, true);
+  } else if constexpr (is_convertible_v<const T &, string_view>) {
+    write_padded(string_view {value}, spec, false);
+  } else if constexpr (is_container<T>::value) {
+    bool first {true};
+    for (const auto &element : value) {   // by reference, nothing is copied
+      if (!first)
+        output.write(" ");
+      first = false;
+      write_value(element, spec);
+    }
+  } else {
+    static_assert(is_container<T>::value, "print doesn't know how to print this type");
+  }
+}
+
+// whether the type letter and precision of a {} make sense for the argument - for a container, for its elements
+template <typename T>
+constexpr bool spec_fits(const Spec &spec) {
+  if constexpr (is_container<T>::value) {
+    return spec_fits<decay_t<decltype(*begin(declval<const T &>()))>>(spec);
+  } else {
+    constexpr bool is_text = is_convertible_v<const T &, string_view> || is_same_v<T, char> || is_same_v<T, bool>;
+    constexpr bool is_number = is_integral_v<T> && !is_same_v<T, bool>;
+    if (spec.precision >= 0 && !is_floating_point_v<T>)
+      return false;
+    switch (spec.type) {
+      case 'd': case 'x': return is_number;
+      case 'f': case 'e': return is_floating_point_v<T>;
+      case 's': return is_text;
+      default:  return true;
+    }
+  }
+}
+
+template <const auto &format, size_t... I, typename... Args>
+void print_segments(index_sequence<I...>, const tuple<const Args &...> &args) {
+  auto one = [&](auto index) {
+    constexpr const Segment &segment = format.segments[decltype(index)::value];
+    if constexpr (segment.is_argument) {
+      using Arg = decay_t<tuple_element_t<format.segments[decltype(index)::value].argument, tuple<Args...>>>;
+      static_assert(spec_fits<Arg>(segment.spec),
+                    "the type in a {} of the format doesn't fit the argument: d and x are for integers, f, e and a .precision for floating point, s for text");
+      write_value(get<segment.argument>(args), segment.spec);
+    } else
+      output.write(format.literal(segment));
+  };
+  (one(integral_constant<size_t, I> {}), ...);
+}
+
+template <const auto &format, typename... Args>
+void print(const Args &... args) {
+  static_assert(format.argument_count == sizeof...(Args), "the number of {} in the format and the number of arguments differ");
+  print_segments<format>(make_index_sequence<format.segment_count> {}, tuple<const Args &...> {args...});
+}
+
+// the overload set from above, to compare with
+void print(int num) {
+  cout << "Printing int: " << num << endl;
+}
+void print(double num) {
+  cout << "Printing double: " << num << endl;
+}
+void print(string s) {
+  cout << "Printing string: " << s << endl;
+}
+void print(string s, string t) {
+  cout << "Printing 2 strings: " << s << " and " << t << endl;
+}
+void print(vector<string> v) {
+  cout << "Printing vector of strings: " ;
+  for (auto s: v )
+      cout << s + " ";
+  cout << endl;
+}
+
+static constexpr Format print_int {"Printing int: {}\n"};
+static constexpr Format print_double {"Printing double: {}\n"};
+static constexpr Format print_string {"Printing string: {}\n"};
+static constexpr Format print_strings {"Printing 2 strings: {} and {}\n"};
+static constexpr Format print_vector {"Printing vector of strings: {} \n"};
+
+void benchmark(size_t lines) {
+  vector<string> three_stooges {"Larry", "Moe", "Curly"};
+  string s {"C++ string"};
+  auto start = chrono::steady_clock::now();
+  for (size_t i {0}; i < lines; i += 5) {
+    print(static_cast<int>(i));
+    print(i * 0.5);
+    print(s);
+    print("C-style string", s);
+    print(three_stooges);
+  }
+  cout.flush();
+  auto overloads_done = chrono::steady_clock::now();
+  for (size_t i {0}; i < lines; i += 5) {
+    print<print_int>(static_cast<int>(i));
+    print<print_double>(i * 0.5);
+    print<print_string>(s);
+    print<print_strings>("C-style string", s);
+    print<print_vector>(three_stooges);
+  }
+  flush_output();
+  auto done = chrono::steady_clock::now();
+  double overloads = chrono::duration<double>(overloads_done - start).count();
+  double variadic = chrono::duration<double>(done - overloads_done).count();
+  cerr << lines << " lines: overloads and cout " << overloads << " s, print<format> " << variadic << " s (" << overloads / variadic << "x)" << endl;
+}
+
+static constexpr Format table_row {"{:<10}|{:>8}|{:*>10.3f}|{:x}\n"};
+static constexpr Format braces {"{{{}}} is {} in a set\n"};
+static constexpr Format fixed_big {"{:f} and {:f}\n"};
+static constexpr Format char_code {"{} {:d} {:x}\n"};
+
+int main(int argc, char *argv[]) {
+  if (argc > 1 && string_view {argv[1]} == "--benchmark") {
+    benchmark(argc > 2 ? stoul(argv[2]) : 5'000'000);
+    return 0;
+  }
+  print<print_int>(100);
+  print<print_int>('A');                  // a char is printed as a character now, not promoted to int
+  print<print_double>(123.5);
+  print<print_double>(123.3F);            // the shortest text for the float: 123.3
+  print<print_string>("C-style string");
+  string s {"C++ string"};
+  print<print_string>(s);
+  print<print_strings>("C-style string", s);
+  vector<string> three_stooges {"Larry", "Moe", "Curly"};
+  print<print_vector>(three_stooges);     // by reference, no copy
+  print<table_row>("Moe", 42, 3.14159, 255u);
+  print<braces>(7, "one");
+  print<fixed_big>(1e20, vector<double> {0.5, 1e-7});
+  print<char_code>('A', 'A', 'A');        // A 65 41
+  // print<print_strings>(s);             // compile error: the number of {} in the format and the number of arguments differ
+  // print<table_row>("Moe", 42, 3.14159, 2.5);   // compile error: {:x} on a double
+  flush_output();
+  return 0;
+}
+
 /*
 Overloading Functions - Calculating Area
 In this exercise you will create a program that computes the area of two shapes, a square and a rectangle, by calling the overloaded function find_area.
@@ -4882,6 +10579,204 @@ int main() {
   return 0;
 }
 
+// Passing containers around without copying them
+// print_vector(vector<string> v) from earlier makes a complete copy of the vector, and of every string in it, on every call - for a guest list of 100,000 names that's 100,001 trips to the memory allocator just to print it. Even the const & version above still copies every string once: for (auto s: v) makes s a copy, for (const auto &s: v) doesn't. The helpers below never copy what they are given:
+//   print_vector / print_items / print_range - take a const &, a span (a pointer and a length, it can view a vector, an array or part of one) or any container, and look at the elements by reference
+//   VectorBuilder - reserves room once and moves the elements in; build() hands the finished vector over without a copy
+//   append - moves the elements of one vector to the end of another
+// To be sure they stay that way, every operator new in this program is counted, per thread. expect_allocations runs a piece of code and compares how many allocations it made with what we expect, so an accidental copy of a big container is caught - run the program with --check, which exits with 1 if any check fails (it also shows that the old by-value print_vector is caught). --benchmark [names] [rounds] times passing a big vector through the by-value and the by-reference helpers. std::span needs C++20 (-std=c++20).
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <list>
+#include <span>
+#include <new>
+#include <chrono>
+#include <utility>
+using namespace std;
+
+// every allocation of this thread is counted
+thread_local size_t allocations_in_thread {0};
+void *operator new(size_t size) {
+  ++allocations_in_thread;
+  if (void *p = malloc(size))
+    return p;
+  throw bad_alloc {};
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+void print_vector(const vector<string> &v, ostream &os = cout) {
+  for (const auto &s : v)
+    os << s << " ";
+  os << "\n";
+}
+
+template <typename T>
+void print_items(span<const T> items, ostream &os = cout, string_view separator = " ") {
+  for (const T &item : items)
+    os << item << separator;
+  os << "\n";
+}
+
+template <typename Range>
+void print_range(const Range &range, ostream &os = cout, string_view separator = " ") {
+  for (const auto &item : range)
+    os << item << separator;
+  os << "\n";
+}
+
+template <typename T>
+class VectorBuilder {
+  vector<T> items;
+public:
+  explicit VectorBuilder(size_t expected = 0) { items.reserve(expected); }
+  // by value: an lvalue is copied once (that's what was asked for), a temporary or a move()d object is only moved
+  VectorBuilder &add(T item) {
+    items.push_back(std::move(item));
+    return *this;
+  }
+  template <typename... Args>
+  VectorBuilder &emplace(Args &&... args) {
+    items.emplace_back(std::forward<Args>(args)...);
+    return *this;
+  }
+  size_t size() const { return items.size(); }
+  vector<T> build() && { return std::move(items); }   // only on a builder we're done with: std::move(builder).build()
+};
+
+// moves the elements of from to the end of to, from is left empty
+template <typename T>
+void append(vector<T> &to, vector<T> &&from) {
+  if (to.empty()) {
+    to = std::move(from);                 // no elements to keep: take the whole buffer
+  } else {
+    to.reserve(to.size() + from.size());
+    for (T &item : from)
+      to.push_back(std::move(item));
+  }
+  from.clear();
+}
+
+// the old one, for the check and the benchmark
+void print_vector_by_value(vector<string> v, ostream &os) {
+  for (auto s : v)
+    os << s << " ";
+  os << "\n";
+}
+
+// an output stream that only counts what's written to it, so the checks measure the helpers and not the screen
+class CountingBuffer : public streambuf {
+  size_t written {0};
+protected:
+  int_type overflow(int_type c) override {
+    ++written;
+    return traits_type::not_eof(c);
+  }
+  streamsize xsputn(const char *, streamsize n) override {
+    written += static_cast<size_t>(n);
+    return n;
+  }
+public:
+  size_t size() const { return written; }
+};
+
+// runs work and reports whether the number of allocations it made is between at_least and at_most
+template <typename Work>
+bool expect_allocations(string_view name, size_t at_least, size_t at_most, Work work) {
+  size_t before = allocations_in_thread;
+  work();
+  size_t made = allocations_in_thread - before;
+  bool ok = made >= at_least && made <= at_most;
+  cout << (ok ? "  ok     " : "  FAILED ") << left << setw(52) << name << right << setw(8) << made << " allocation(s)" << endl;
+  return ok;
+}
+
+vector<string> make_guests(size_t count) {
+  VectorBuilder<string> builder {count};
+  for (size_t i {0}; i < count; ++i)
+    builder.add("Guest number " + to_string(i) + " of the big party");   // longer than the small string buffer, so a copy allocates
+  return std::move(builder).build();
+}
+
+bool check() {
+  const size_t count {100'000};
+  vector<string> guests = make_guests(count);
+  CountingBuffer buffer;
+  ostream out {&buffer};
+  bool ok {true};
+  cout << "with " << count << " guests:" << endl;
+  ok &= expect_allocations("print_vector(const vector<string> &)", 0, 0, [&]() { print_vector(guests, out); });
+  ok &= expect_allocations("print_items(span<const string>)", 0, 0, [&]() { print_items<string>(guests, out); });
+  ok &= expect_allocations("print_items on the first half", 0, 0, [&]() { print_items(span<const string> {guests}.first(count / 2), out); });
+  list<string> guest_list(guests.begin(), guests.begin() + 100);
+  ok &= expect_allocations("print_range(list<string>)", 0, 0, [&]() { print_range(guest_list, out); });
+  ok &= expect_allocations("VectorBuilder, strings moved in, build()", 1, 1, [&]() {   // the reserve, nothing else
+    VectorBuilder<string> builder {count};
+    for (string &guest : guests)
+      builder.add(std::move(guest));
+    guests = std::move(builder).build();
+  });
+  vector<string> more = make_guests(count);
+  ok &= expect_allocations("append(vector, moved vector)", 1, 1, [&]() { append(guests, std::move(more)); });   // one bigger buffer
+  // the copy we want to catch: the by-value print_vector copies the vector and every string, and the loop copies every string again
+  ok &= expect_allocations("print_vector_by_value is caught copying", 2 * guests.size(), SIZE_MAX, [&]() { print_vector_by_value(guests, out); });
+  cout << (ok ? "all checks passed" : "some checks FAILED") << endl;
+  return ok;
+}
+
+template <typename Function>
+double time_seconds(Function function) {
+  auto start = chrono::steady_clock::now();
+  function();
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+void benchmark(size_t count, size_t rounds) {
+  vector<string> guests = make_guests(count);
+  CountingBuffer buffer;
+  ostream out {&buffer};
+  size_t before = allocations_in_thread;
+  double by_value = time_seconds([&]() {
+    for (size_t r {0}; r < rounds; ++r)
+      print_vector_by_value(guests, out);
+  });
+  size_t by_value_allocations = allocations_in_thread - before;
+  before = allocations_in_thread;
+  double by_reference = time_seconds([&]() {
+    for (size_t r {0}; r < rounds; ++r)
+      print_vector(guests, out);
+  });
+  size_t by_reference_allocations = allocations_in_thread - before;
+  cout << rounds << " rounds of " << count << " names" << fixed << setprecision(3) << endl;
+  cout << "print_vector(vector<string> v)        : " << setw(8) << by_value << " s, " << by_value_allocations << " allocations" << endl;
+  cout << "print_vector(const vector<string> &v) : " << setw(8) << by_reference << " s, " << by_reference_allocations << " allocations  ("
+       << setprecision(1) << by_value / by_reference << "x)" << endl;
+}
+
+int main(int argc, char *argv[]) {
+  string_view mode {argc > 1 ? argv[1] : ""};
+  if (mode == "--check")
+    return check() ? 0 : 1;
+  if (mode == "--benchmark") {
+    benchmark(argc > 2 ? stoul(argv[2]) : 100'000, argc > 3 ? stoul(argv[3]) : 100);
+    return 0;
+  }
+
+  vector<string> stooges = std::move(VectorBuilder<string> {3}.add("Larry").add("Moe").add("Curly")).build();
+  print_vector(stooges);
+  print_items<string>(stooges, cout, ", ");
+  print_items(span<const string> {stooges}.subspan(1), cout);   // Moe Curly
+  vector<string> more_stooges {"Shemp", "Joe"};
+  append(stooges, std::move(more_stooges));
+  print_range(stooges);
+  cout << endl;
+  return 0;
+}
+
 /*
 Using Pass by Reference - Print a Guest List
 In this exercise you will rewrite the previous Guest List exercise only this time with the use of reference variables.
@@ -5516,5 +11411,256 @@ int test_function_activation_count() {
   return function_activation_count;
 }
 
+// Recursion - Trampoline and Explicit Stack Runtime
+// Every recursive call above pushes a new activation record on the call stack. factorial(8) or a_penny_doubled_everyday(25) are fine, but ask for factorial(1000000) on a worker thread that only has a 256 KB stack and the program crashes with a stack overflow. Remember, anything that can be done recursively can also be done with iteration, and we can keep the recursive definition while doing it. There are two classic tricks. The first one is a trampoline: a tail-recursive function (the recursive call is the very last thing it does, like a_penny_doubled_everyday) doesn't return a call, it returns "here are my next arguments", and a small loop keeps bouncing until a result comes back. No frames at all. Factorial still has work to do after its call (it multiplies), but multiplication doesn't care about the order, so it carries the product along in an accumulator and becomes a trampoline too. The second trick is an explicit stack, for functions whose frames really have to stay around: fibonacci (two calls per frame) and a flood fill that walks a grid depth-first, where every frame remembers its cell and which neighbours it has already tried. We keep those activation records ourselves on the heap. The frames come from a FramePool that allocates them in big blocks and keeps the blocks once the stack has grown into them, so a push is just a pointer bump, not a new/delete. The depth is now only limited by the heap, not by the thread's stack size: the flood fill runs 10 million frames deep on a thread with a 256 KB stack.
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <thread>
+#include <chrono>
+#if defined(__GLIBC__)
+#include <pthread.h>    // pthread_setattr_default_np
+#endif
+using namespace std;
+
+// FramePool - frames live in heap blocks of block_size frames each. Blocks are allocated the first time the stack grows into them and kept afterwards, so once a depth has been reached, pushing a frame is just an index increment. Frames never move once pushed.
+template <typename Frame>
+class FramePool {
+  vector<unique_ptr<Frame[]>> blocks;
+  size_t block_size;
+public:
+  explicit FramePool(size_t block_size = 16384) : block_size{block_size} {}
+  Frame *block(size_t index) {
+    if (index == blocks.size())
+      blocks.push_back(make_unique<Frame[]>(block_size));
+    return blocks[index].get();
+  }
+  size_t frames_per_block() const { return block_size; }
+};
+
+// CallStack - our own stack of activation records on top of the pool. A reference to top() stays valid while we push the next call. The common case of push and pop is a single pointer compare and step; only crossing into another block goes back to the pool.
+template <typename Frame>
+class CallStack {
+  FramePool<Frame> pool;
+  Frame *base {nullptr};      // first frame of the current block
+  Frame *limit {nullptr};     // one past the last frame of the current block
+  Frame *top_frame {nullptr}; // nullptr when the stack is empty
+  size_t block_index {0};
+  void enter_block(size_t index) {
+    block_index = index;
+    base = pool.block(index);
+    limit = base + pool.frames_per_block();
+  }
+public:
+  void push(const Frame &frame) {
+    if (top_frame == nullptr) {
+      enter_block(0);
+      top_frame = base;
+    } else if (++top_frame == limit) {
+      enter_block(block_index + 1);
+      top_frame = base;
+    }
+    *top_frame = frame;
+  }
+  void pop() {
+    if (top_frame != base) {
+      --top_frame;
+    } else if (block_index == 0) {
+      top_frame = nullptr;
+    } else {                  // step back into the previous block
+      enter_block(block_index - 1);
+      top_frame = limit - 1;
+    }
+  }
+  Frame &top() { return *top_frame; }
+  bool empty() const { return top_frame == nullptr; }
+};
+
+// Trampoline - step() either finishes with a result or returns the arguments of the next (tail) call.
+template <typename Result, typename Args>
+struct Bounce {
+  bool done;
+  Result result;
+  Args next;
+};
+template <typename Result, typename Args, typename Step>
+Result trampoline(Step step, Args args) {
+  while (true) {
+    Bounce<Result, Args> bounce = step(args);
+    if (bounce.done)
+      return bounce.result;
+    args = bounce.next;
+  }
+}
+
+// a_penny_doubled_everyday is tail recursive, so it only needs the trampoline
+struct PennyArgs {
+  int n;
+  double amount;
+};
+double a_penny_doubled_everyday(int n, double amount = 0.01) {
+  return trampoline<double>([](PennyArgs args) -> Bounce<double, PennyArgs> {
+    if (args.n <= 1)
+      return {true, args.amount, args};                   // base case
+    return {false, 0.0, {args.n - 1, args.amount * 2}};   // tail call
+  }, PennyArgs{n, amount});
+}
+
+// factorial multiplies after the call returns, but multiplication doesn't care about the order, so we can carry the product along in an accumulator and it becomes tail recursive too
+struct FactorialArgs {
+  unsigned long long n;
+  unsigned long long product;
+};
+unsigned long long factorial(unsigned long long n) {
+  return trampoline<unsigned long long>([](FactorialArgs args) -> Bounce<unsigned long long, FactorialArgs> {
+    if (args.n == 0)
+      return {true, args.product, args};                      // base case: factorial(0) = 1
+    return {false, 0, {args.n - 1, args.n * args.product}};   // recursive case: n * factorial(n-1)
+  }, FactorialArgs{n, 1});
+}
+
+// the native versions from above, to compare results and timings - and native_fibonacci for the small leaves of fibonacci below
+unsigned long long native_factorial(unsigned long long n) {
+  if (n == 0)
+    return 1;
+  return n * native_factorial(n-1);
+}
+unsigned long long native_fibonacci(unsigned long long n) {
+  if (n <= 1)
+    return n;
+  return native_fibonacci(n-1) + native_fibonacci(n-2);
+}
+
+// fibonacci makes two calls, so it really needs frames. But the only thing a frame does after its calls return is add, and addition doesn't care about the order either, so a frame is just the n that is still waiting to be evaluated and all the base cases add up into one sum. Fib(n) is replaced in place by Fib(n-1) and Fib(n-2) is pushed on top of it.
+// Almost all the calls are near the leaves, and there a push and pop on our stack costs more than a native call: with the explicit stack all the way down this runs about 1.8x slower than native_fibonacci. So below leaf_size we hand the subproblem to the native recursion, which is at most leaf_size frames deep (a few hundred bytes of stack, safe on any thread), and the two versions run at the same speed.
+unsigned long long fibonacci(unsigned long long n) {
+  const unsigned long long leaf_size {16};
+  static thread_local CallStack<unsigned long long> stack; // keep the pool between calls
+  unsigned long long sum {0};
+  stack.push(n);
+  while (!stack.empty()) {
+    unsigned long long &pending = stack.top();
+    if (pending <= leaf_size) {       // base cases, and the small subproblems
+      sum += native_fibonacci(pending);
+      stack.pop();
+    } else {                          // recursive case: Fib(n-1) + Fib(n-2)
+      unsigned long long second = pending - 2;
+      --pending;
+      if (second <= leaf_size)
+        sum += native_fibonacci(second);   // answer it right away instead of pushing it
+      else
+        stack.push(second);
+    }
+  }
+  return sum;
+}
+
+// flood fill: how many open cells can be reached from start, moving right, down, left and up. Written recursively it is fill(cell) { mark cell; for each open neighbour: fill(neighbour); } - not tail recursive, after every call the frame goes on with its next neighbour, and on an open grid the path snakes through every cell, so the depth is the number of cells.
+const uint8_t open_cell {0}, wall {1}, filled {2};
+struct FillFrame {
+  uint32_t cell;
+  uint8_t next_direction;           // 0 right, 1 down, 2 left, 3 up, 4 all done
+};
+size_t flood_fill(vector<uint8_t> &grid, size_t width, size_t start, size_t &max_depth) {
+  CallStack<FillFrame> stack;
+  size_t count {1}, depth {1};
+  grid[start] = filled;
+  stack.push({static_cast<uint32_t>(start), 0});
+  max_depth = 1;
+  while (!stack.empty()) {
+    FillFrame &frame = stack.top();
+    if (frame.next_direction == 4) {  // the call returns
+      stack.pop();
+      --depth;
+      continue;
+    }
+    size_t cell = frame.cell, x = cell % width;
+    size_t next {0};
+    bool inside {false};
+    switch (frame.next_direction++) {
+      case 0: inside = x + 1 < width; next = cell + 1; break;
+      case 1: inside = cell + width < grid.size(); next = cell + width; break;
+      case 2: inside = x > 0; next = cell - 1; break;
+      case 3: inside = cell >= width; next = cell - width; break;
+    }
+    if (inside && grid[next] == open_cell) {   // the recursive call
+      grid[next] = filled;
+      ++count;
+      stack.push({static_cast<uint32_t>(next), 0});
+      max_depth = max(max_depth, ++depth);
+    }
+  }
+  return count;
+}
+size_t native_flood_fill(vector<uint8_t> &grid, size_t width, size_t cell) {
+  grid[cell] = filled;
+  size_t count {1}, x = cell % width;
+  if (x + 1 < width && grid[cell + 1] == open_cell)
+    count += native_flood_fill(grid, width, cell + 1);
+  if (cell + width < grid.size() && grid[cell + width] == open_cell)
+    count += native_flood_fill(grid, width, cell + width);
+  if (x > 0 && grid[cell - 1] == open_cell)
+    count += native_flood_fill(grid, width, cell - 1);
+  if (cell >= width && grid[cell - width] == open_cell)
+    count += native_flood_fill(grid, width, cell - width);
+  return count;
+}
+
+template <typename Function>
+double time_ms(Function function) {
+  auto start = chrono::steady_clock::now();
+  function();
+  return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+int main() {
+  cout << factorial(8) << endl;                                       // 40320
+  cout << fibonacci(30) << endl;                                      // 832040
+  cout << setprecision(10) << a_penny_doubled_everyday(18) << endl;   // 1310.72
+
+  // depths that would overflow a small native stack
+  cout << "factorial(10000000) mod 2^64 = " << factorial(10'000'000) << endl; // 0 - the product wraps around long before that
+  cout << "penny after 5000000 days = " << a_penny_doubled_everyday(5'000'000) << endl; // inf - a double can't hold it
+  
+  // a flood fill 10 million frames deep on a thread with a 256 KB stack - native_flood_fill would overflow that stack after a few thousand cells.
+  // std::thread has no stack size option; with glibc we set the default for new threads, elsewhere the thread gets the platform default, and the explicit stack doesn't care either way
+#if defined(__GLIBC__)
+  pthread_attr_t attributes;
+  pthread_attr_init(&attributes);
+  pthread_attr_setstacksize(&attributes, 256 * 1024);
+  pthread_setattr_default_np(&attributes);
+  pthread_attr_destroy(&attributes);
+#endif
+  thread small_stack {[]() {
+    const size_t width {4000}, height {2500};
+    vector<uint8_t> grid(width * height, open_cell);
+    size_t max_depth {0};
+    size_t cells = flood_fill(grid, width, 0, max_depth);
+    cout << "flood fill on a 256 KB stack: " << cells << " cells, " << max_depth << " frames deep" << endl;   // 10000000 and 10000000
+  }};
+  small_stack.join();
+
+  // timings against the native recursion (keep the native depth small enough for the main thread)
+  // with g++ -O2 the trampoline factorial and the explicit stack fibonacci run as fast as the native versions (fibonacci thanks to its native leaves, see above), and the flood fill is a bit faster: its 8-byte frames are smaller than a native call's.
+  unsigned long long sink {0};
+  double native = time_ms([&]() { for (int i {0}; i < 1000; ++i) sink += native_factorial(10'000 + i % 2); });
+  double runtime = time_ms([&]() { for (int i {0}; i < 1000; ++i) sink += factorial(10'000 + i % 2); });
+  cout << "factorial(10000) x1000 - native: " << native << " ms, trampoline: " << runtime << " ms" << endl;
+  native = time_ms([&]() { sink += native_fibonacci(32); });
+  runtime = time_ms([&]() { sink += fibonacci(32); });
+  cout << "fibonacci(32) - native: " << native << " ms, explicit stack: " << runtime << " ms" << endl;
+  const size_t width {200};
+  vector<uint8_t> grid(width * width, open_cell);   // 40000 frames deep, fine for the main thread's stack
+  size_t max_depth {0};
+  native = time_ms([&]() { for (int i {0}; i < 20; ++i) { fill(grid.begin(), grid.end(), open_cell); sink += native_flood_fill(grid, width, 0); } });
+  runtime = time_ms([&]() { for (int i {0}; i < 20; ++i) { fill(grid.begin(), grid.end(), open_cell); sink += flood_fill(grid, width, 0, max_depth); } });
+  cout << "flood fill 200x200 x20 - native: " << native << " ms, explicit stack: " << runtime << " ms" << endl;
+
+  cout << "checksum: " << sink << endl; // use the results so the compiler can't throw the timed work away
+  return 0;
+}
+
 /***************************************************************************************************************************/
 